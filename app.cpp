@@ -1,626 +1,6745 @@
-#include <iostream>
-#include <fstream>
-#include <sstream>
-#include <vector>
-#include <string>
-#include <map>
-#include <iomanip>
-#include <algorithm>
-#include <cctype>
-#include <functional>
-
-#define VERSION "1.0.0"
-#define SOFTWARE_NAME "RowDB"
-
-// Utility functions
-std::vector<std::string> split(const std::string &s, char delimiter);
-std::string trim(const std::string &s);
-std::string toLower(const std::string &s);
-bool isNumber(const std::string &s);
-bool fileExists(const std::string &filename);
-
-// Cell class representing a single cell in the table
-class Cell {
-private:
-    std::string value;
-public:
-    Cell() : value("") {}
-    Cell(const std::string &val) : value(val) {}
-    
-    std::string getValue() const { return value; }
-    void setValue(const std::string &val) { value = val; }
-    
-    friend std::ostream& operator<<(std::ostream& os, const Cell& cell) {
-        os << cell.value;
-        return os;
-    }
-};
-
-// Column class representing a column in the table
-class Column {
-private:
-    std::string name;
-    std::vector<Cell> cells;
-public:
-    Column() : name("") {} // Default constructor
-    Column(const std::string &colName) : name(colName) {}
-    
-    std::string getName() const { return name; }
-    void setName(const std::string &colName) { name = colName; }
-    
-    size_t size() const { return cells.size(); }
-    
-    Cell& operator[](size_t index) {
-        if (index >= cells.size()) {
-            cells.resize(index + 1);
-        }
-        return cells[index];
-    }
-    
-    const Cell& operator[](size_t index) const {
-        static Cell emptyCell;
-        if (index < cells.size()) {
-            return cells[index];
-        }
-        return emptyCell;
-    }
-    
-    void addCell(const std::string &value) {
-        cells.emplace_back(value);
-    }
-    
-    void insertCell(size_t index, const std::string &value) {
-        if (index >= cells.size()) {
-            cells.resize(index + 1);
-        }
-        cells[index] = Cell(value);
-    }
-    
-    void removeCell(size_t index) {
-        if (index < cells.size()) {
-            cells.erase(cells.begin() + index);
-        }
-    }
-    
-    friend std::ostream& operator<<(std::ostream& os, const Column& col) {
-        os << col.name << ": ";
-        for (const auto& cell : col.cells) {
-            os << cell.getValue() << " ";
-        }
-        return os;
-    }
-};
-
-// Table class representing a complete table
-class Table {
-private:
-    std::string name;
-    std::map<std::string, Column> columns;
-    std::vector<std::string> columnOrder;
-    
-public:
-    Table() : name("") {} // Default constructor
-    Table(const std::string &tableName) : name(tableName) {}
-    
-    std::string getName() const { return name; }
-    
-    void addColumn(const std::string &colName) {
-        if (columns.find(colName) == columns.end()) {
-            columns[colName] = Column(colName);
-            columnOrder.push_back(colName);
-        }
-    }
-    
-    void removeColumn(const std::string &colName) {
-        auto it = columns.find(colName);
-        if (it != columns.end()) {
-            columns.erase(it);
-            columnOrder.erase(std::remove(columnOrder.begin(), columnOrder.end(), colName), columnOrder.end());
-        }
-    }
-    
-    Column& getColumn(const std::string &colName) {
-        return columns[colName];
-    }
-    
-    const Column& getColumn(const std::string &colName) const {
-        static Column emptyColumn("");
-        auto it = columns.find(colName);
-        if (it != columns.end()) {
-            return it->second;
-        }
-        return emptyColumn;
-    }
-    
-    std::vector<std::string> getColumnNames() const {
-        return columnOrder;
-    }
-    
-    size_t getRowCount() const {
-        if (columns.empty()) return 0;
-        return columns.begin()->second.size();
-    }
-    
-    Cell& getCell(const std::string &colName, size_t rowIndex) {
-        return columns[colName][rowIndex];
-    }
-    
-    const Cell& getCell(const std::string &colName, size_t rowIndex) const {
-        static Cell emptyCell;
-        auto it = columns.find(colName);
-        if (it != columns.end()) {
-            return it->second[rowIndex];
-        }
-        return emptyCell;
-    }
-    
-    void setCell(const std::string &colName, size_t rowIndex, const std::string &value) {
-        columns[colName][rowIndex].setValue(value);
-    }
-    
-    void addRow(const std::vector<std::string> &values) {
-        if (values.size() != columnOrder.size()) {
-            throw std::runtime_error("Number of values doesn't match number of columns");
-        }
-        
-        for (size_t i = 0; i < columnOrder.size(); i++) {
-            columns[columnOrder[i]].addCell(values[i]);
-        }
-    }
-    
-    void saveToFile(const std::string &filename) {
-        std::ofstream file(filename);
-        if (!file.is_open()) {
-            throw std::runtime_error("Cannot open file for writing: " + filename);
-        }
-        
-        file << "TABLE:" << name << "\n";
-        file << "COLUMNS:";
-        for (size_t i = 0; i < columnOrder.size(); i++) {
-            if (i > 0) file << ",";
-            file << columnOrder[i];
-        }
-        file << "\n";
-        
-        size_t rowCount = getRowCount();
-        file << "ROWS:" << rowCount << "\n";
-        file << "DATA:\n";
-        
-        for (size_t i = 0; i < rowCount; i++) {
-            for (size_t j = 0; j < columnOrder.size(); j++) {
-                if (j > 0) file << ",";
-                file << columns[columnOrder[j]][i].getValue();
-            }
-            file << "\n";
-        }
-        
-        file.close();
-    }
-    
-    static Table loadFromFile(const std::string &filename) {
-        std::ifstream file(filename);
-        if (!file.is_open()) {
-            throw std::runtime_error("Cannot open file: " + filename);
-        }
-        
-        std::string line;
-        
-        // Read table name
-        std::getline(file, line);
-        if (line.substr(0, 6) != "TABLE:") {
-            throw std::runtime_error("Invalid file format: missing TABLE header");
-        }
-        std::string tableName = line.substr(6);
-        
-        // Read columns
-        std::getline(file, line);
-        if (line.substr(0, 8) != "COLUMNS:") {
-            throw std::runtime_error("Invalid file format: missing COLUMNS header");
-        }
-        std::string columnsStr = line.substr(8);
-        std::vector<std::string> colNames = split(columnsStr, ',');
-        
-        Table table(tableName);
-        for (const auto& colName : colNames) {
-            table.addColumn(colName);
-        }
-        
-        // Read row count
-        std::getline(file, line);
-        if (line.substr(0, 5) != "ROWS:") {
-            throw std::runtime_error("Invalid file format: missing ROWS header");
-        }
-        size_t rowCount = std::stoul(line.substr(5));
-        
-        // Skip DATA line
-        std::getline(file, line);
-        
-        // Read data
-        for (size_t i = 0; i < rowCount; i++) {
-            std::getline(file, line);
-            std::vector<std::string> values = split(line, ',');
-            
-            if (values.size() != colNames.size()) {
-                throw std::runtime_error("incorrect syntax in row " + std::to_string(i));
-            }
-            
-            for (size_t j = 0; j < colNames.size(); j++) {
-                table.setCell(colNames[j], i, values[j]);
-            }
-        }
-        
-        file.close();
-        return table;
-    }
-    
-    void displayASCII() const {
-        if (columns.empty()) {
-            std::cout << "Table is empty." << std::endl;
-            return;
-        }
-        // Calculate column widths
-        std::vector<size_t> colWidths;
-        for (const auto& colName : columnOrder) {
-            colWidths.push_back(colName.length());
-        }
-        size_t rowCount = getRowCount();
-        for (size_t i = 0; i < rowCount; i++) {
-            for (size_t j = 0; j < columnOrder.size(); j++) {
-                const Cell& cell = getCell(columnOrder[j], i);
-                if (cell.getValue().length() > colWidths[j]) {
-                    colWidths[j] = cell.getValue().length();
-                }
-            }
-        }
-        // Add extra width for line numbers
-        size_t lineNumWidth = std::to_string(rowCount).length();
-        // Print header
-        std::cout << "+" << std::string(lineNumWidth + 2, '-') << "+";
-        for (size_t width : colWidths) {
-            std::cout << std::string(width + 2, '-') << "+";
-        }
-        std::cout << std::endl;
-        std::cout << "| " << std::setw(lineNumWidth) << std::left << "#" << " |";
-        for (size_t j = 0; j < columnOrder.size(); j++) {
-            std::cout << " " << std::setw(colWidths[j]) << std::left << columnOrder[j] << " |";
-        }
-        std::cout << std::endl;
-        std::cout << "+" << std::string(lineNumWidth + 2, '-') << "+";
-        for (size_t width : colWidths) {
-            std::cout << std::string(width + 2, '-') << "+";
-        }
-        std::cout << std::endl;
-        // Print rows with line numbers
-        for (size_t i = 0; i < rowCount; i++) {
-            std::cout << "| " << std::setw(lineNumWidth) << std::left << (i + 1) << " |";
-            for (size_t j = 0; j < columnOrder.size(); j++) {
-                const Cell& cell = getCell(columnOrder[j], i);
-                std::cout << " " << std::setw(colWidths[j]) << std::left << cell.getValue() << " |";
-            }
-            std::cout << std::endl;
-        }
-        std::cout << "+" << std::string(lineNumWidth + 2, '-') << "+";
-        for (size_t width : colWidths) {
-            std::cout << std::string(width + 2, '-') << "+";
-        }
-        std::cout << std::endl;
-    }
-};
-
-// DatabaseManager class to handle multiple tables and commands
-class DatabaseManager {
-private:
-    std::map<std::string, Table> tables;
-    Table* currentTable = nullptr;
-    
-public:
-    void createTable(const std::string &tableName, const std::vector<std::string> &columns) {
-        if (tables.find(tableName) != tables.end()) {
-            throw std::runtime_error("Table already exists: " + tableName);
-        }
-        
-        Table newTable(tableName);
-        for (const auto& col : columns) {
-            newTable.addColumn(col);
-        }
-        
-        tables[tableName] = newTable;
-        currentTable = &tables[tableName];
-        std::cout << "Table '" << tableName << "' created successfully." << std::endl;
-    }
-    
-    void loadTable(const std::string &filename) {
-    std::string actualFilename = filename;
-    
-    // Check if file exists with .odt extension if not specified
-    if (!fileExists(filename)) {
-        if (!fileExists(filename + ".odt")) {
-            throw std::runtime_error("Cannot open file: " + filename + 
-                                   " (also tried: " + filename + ".odt)");
-        }
-        actualFilename = filename + ".odt";
-    }
-    
-    Table table = Table::loadFromFile(actualFilename);
-    tables[table.getName()] = table;
-    currentTable = &tables[table.getName()];
-    std::cout << "Table '" << table.getName() << "' loaded successfully from '" 
-              << actualFilename << "'." << std::endl;
-    }
-    
-    void saveTable(const std::string &filename) {
-        if (!currentTable) {
-            throw std::runtime_error("No table selected");
-        }
-        
-        currentTable->saveToFile(filename);
-        std::cout << "Table saved to '" << filename << "' successfully." << std::endl;
-    }
-    
-    void selectTable(const std::string &tableName) {
-        auto it = tables.find(tableName);
-        if (it == tables.end()) {
-            throw std::runtime_error("Table not found: " + tableName);
-        }
-        
-        currentTable = &it->second;
-        std::cout << "Selected table: " << tableName << std::endl;
-    }
-    
-    void displayCurrentTable() {
-        if (!currentTable) {
-            throw std::runtime_error("No table selected");
-        }
-        
-        currentTable->displayASCII();
-    }
-    
-    void editCell(const std::string &cellRef, const std::string &newValue) {
-        if (!currentTable) {
-            throw std::runtime_error("No table selected");
-        }
-        // Parse cell reference (e.g., "Name5" or "A5")
-        size_t i = 0;
-        while (i < cellRef.length() && !isdigit(cellRef[i])) ++i;
-        if (i == 0 || i == cellRef.length()) {
-            throw std::runtime_error("Invalid cell reference: " + cellRef);
-        }
-        std::string colName = cellRef.substr(0, i);
-        std::string rowStr = cellRef.substr(i);
-        if (!isNumber(rowStr)) {
-            throw std::runtime_error("Invalid row number: " + rowStr);
-        }
-        size_t rowIndex = std::stoul(rowStr) - 1; // Convert to 0-based index
-        // Check if column exists
-        auto colNames = currentTable->getColumnNames();
-        if (std::find(colNames.begin(), colNames.end(), colName) == colNames.end()) {
-            throw std::runtime_error("Column not found: " + colName);
-        }
-        // Automatically expand rows if needed
-        while (rowIndex >= currentTable->getRowCount()) {
-            std::vector<std::string> emptyRow(colNames.size(), "");
-            currentTable->addRow(emptyRow);
-        }
-        currentTable->setCell(colName, rowIndex, newValue);
-        std::cout << "Cell " << cellRef << " updated to: " << newValue << std::endl;
-    }
-    
-    void addRow(const std::vector<std::string> &values) {
-        if (!currentTable) {
-            throw std::runtime_error("No table selected");
-        }
-        
-        currentTable->addRow(values);
-        std::cout << "Row added successfully." << std::endl;
-    }
-    
-    void listTables() {
-        if (tables.empty()) {
-            std::cout << "No tables loaded." << std::endl;
-            return;
-        }
-        
-        std::cout << "Available tables:" << std::endl;
-        for (const auto& pair : tables) {
-            std::cout << "  " << pair.first << std::endl;
-        }
-    }
-    
-    bool hasCurrentTable() const {
-        return currentTable != nullptr;
-    }
-    
-    std::string getCurrentTableName() const {
-        return currentTable ? currentTable->getName() : "";
-    }
-};
-
-// Utility function implementations
-std::vector<std::string> split(const std::string &s, char delimiter) {
-    std::vector<std::string> tokens;
-    std::string token;
-    std::istringstream tokenStream(s);
-    while (std::getline(tokenStream, token, delimiter)) {
-        tokens.push_back(trim(token));
-    }
-    return tokens;
-}
-
-std::string trim(const std::string &s) {
-    size_t start = s.find_first_not_of(" \t\n\r\f\v");
-    size_t end = s.find_last_not_of(" \t\n\r\f\v");
-    return (start == std::string::npos) ? "" : s.substr(start, end - start + 1);
-}
-
-std::string toLower(const std::string &s) {
-    std::string result = s;
-    std::transform(result.begin(), result.end(), result.begin(), ::tolower);
-    return result;
-}
-
-bool isNumber(const std::string &s) {
-    if (s.empty()) return false;
-    for (char c : s) {
-        if (!isdigit(c)) return false;
-    }
-    return true;
-}
-
-bool fileExists(const std::string &filename) {
-    std::ifstream file(filename);
-    return file.good();
-}
-
-// Main function and command processing
-void showHelp() {
-    std::cout << SOFTWARE_NAME << " - Personal Data Table Manager" << std::endl;
-    std::cout << "Usage:" << std::endl;
-    std::cout << "  " << SOFTWARE_NAME << " [options]" << std::endl;
-    std::cout << "Options:" << std::endl;
-    std::cout << "  -c, --create <table> [columns...]  Create a new table" << std::endl;
-    std::cout << "  -e, --edit <cellRef> <value>       Edit a cell (e.g., A5)" << std::endl;
-    std::cout << "  -v, --view                         View current table" << std::endl;
-    std::cout << "  -s, --select <table>               Select a table" << std::endl;
-    std::cout << "  -l, --load <file>                  Load a table from file" << std::endl;
-    std::cout << "  -sv, --save <file>                 Save current table to file" << std::endl;
-    std::cout << "  --list                             List all loaded tables" << std::endl;
-    std::cout << "  --help                             Show this help message" << std::endl;
-    std::cout << "  --version                          Show version information" << std::endl;
-    std::cout << std::endl;
-    std::cout << "Supported Formats:" << std::endl;
-    std::cout << "  .odt - Open Data Table (unencrypted)" << std::endl;
-}
-
-void showVersion() {
-    std::cout << SOFTWARE_NAME << " version " << VERSION << std::endl;
-}
-
-#ifdef _WIN32
-#include <windows.h>
-#endif
-
-int main(int argc, char* argv[]) {
-#ifdef _WIN32
-    SetConsoleTitleA(SOFTWARE_NAME);
-#endif
-    DatabaseManager dbManager;
-    
-    // If no arguments, start interactive mode
-    if (argc == 1) {
-        std::cout << SOFTWARE_NAME << " " << VERSION << std::endl;
-        std::cout << "Type 'help' for commands or 'exit' to quit." << std::endl;
-        
-        std::string input;
-        while (true) {
-            if (dbManager.hasCurrentTable()) {
-                std::cout << SOFTWARE_NAME << "/" << dbManager.getCurrentTableName() << " >> ";
-            } else {
-                std::cout << SOFTWARE_NAME << " >> ";
-            }
-            
-            std::getline(std::cin, input);
-            if (input.empty()) continue;
-            
-            std::vector<std::string> args = split(input, ' ');
-            std::string command = toLower(args[0]);
-            
-            if (command == "exit" || command == "quit") {
-                break;
-            } else if (command == "help") {
-                showHelp();
-            } else if (command == "version") {
-                showVersion();
-            } else if (command == "-c" || command == "--create") {
-                if (args.size() < 3) {
-                    std::cout << "Error: Table name and at least one column required." << std::endl;
-                    continue;
-                }
-                
-                std::string tableName = args[1];
-                std::vector<std::string> columns(args.begin() + 2, args.end());
-                dbManager.createTable(tableName, columns);
-            } else if (command == "-e" || command == "--edit") {
-                if (args.size() < 3) {
-                    std::cout << "Error: Cell reference and value required." << std::endl;
-                    continue;
-                }
-                
-                std::string cellRef = args[1];
-                std::string value = args[2];
-                for (size_t i = 3; i < args.size(); i++) {
-                    value += " " + args[i];
-                }
-                
-                try {
-                    dbManager.editCell(cellRef, value);
-                } catch (const std::exception &e) {
-                    std::cout << "Error: " << e.what() << std::endl;
-                }
-            } else if (command == "-v" || command == "--view") {
-                try {
-                    dbManager.displayCurrentTable();
-                } catch (const std::exception &e) {
-                    std::cout << "Error: " << e.what() << std::endl;
-                }
-            } else if (command == "-s" || command == "--select") {
-                if (args.size() < 2) {
-                    std::cout << "Error: Table name required." << std::endl;
-                    continue;
-                }
-                
-                std::string tableName = args[1];
-                try {
-                    dbManager.selectTable(tableName);
-                } catch (const std::exception &e) {
-                    std::cout << "Error: " << e.what() << std::endl;
-                }
-            } else if (command == "-l" || command == "--load") {
-                if (args.size() < 2) {
-                    std::cout << "Error: Filename required." << std::endl;
-                    continue;
-                }
-                std::string filename = args[1];
-                try {
-                    dbManager.loadTable(filename);
-                } catch (const std::exception &e) {
-                    std::cout << "Error: " << e.what() << std::endl;
-                }
-            } else if (command == "-sv" || command == "--save") {
-                if (args.size() < 2) {
-                    std::cout << "Error: Filename required." << std::endl;
-                    continue;
-                }
-                std::string filename = args[1];
-                try {
-                    dbManager.saveTable(filename);
-                } catch (const std::exception &e) {
-                    std::cout << "Error: " << e.what() << std::endl;
-                }
-            } else if (command == "--list") {
-                dbManager.listTables();
-            } else {
-                std::cout << "Unknown command: " << command << std::endl;
-                std::cout << "Type 'help' for available commands." << std::endl;
-            }
-        }
-    } else {
-        // Process command line arguments
-        std::vector<std::string> args;
-        for (int i = 1; i < argc; i++) {
-            args.push_back(argv[i]);
-        }
-        
-        std::string command = toLower(args[0]);
-        
-        if (command == "--help") {
-            showHelp();
-        } else if (command == "--version") {
-            showVersion();
-        } else {
-            std::cout << "For interactive mode, run without arguments." << std::endl;
-            std::cout << "Use --help for more information." << std::endl;
-        }
-    }
-    
-    return 0;
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <map>
+#include <iomanip>
+#include <algorithm>
+#include <cctype>
+#include <functional>
+#include <cstring>
+#include <cstdint>
+#include <cerrno>
+#include <stdexcept>
+#include <cstdio>
+#include <iterator>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <memory>
+#include <deque>
+#include <charconv>
+#include <string_view>
+#include <unordered_set>
+#include <unordered_map>
+#include <limits>
+#include <type_traits>
+#include <filesystem>
+#include <ctime>
+#include <random>
+#include <exception>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <glob.h>
+#else
+#include <io.h>
+#include <malloc.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// io_uring is used for table file I/O when the kernel headers are present;
+// build with -DROWDB_NO_IO_URING to always use the pread/pwrite fallback
+#if defined(__linux__) && defined(__has_include) && !defined(ROWDB_NO_IO_URING)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#define ROWDB_HAVE_IO_URING 1
+#endif
+#endif
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/mempolicy.h>)
+#include <linux/mempolicy.h>
+#include <sys/syscall.h>
+#define ROWDB_HAVE_NUMA 1
+#endif
+#endif
+
+#define IO_BLOCK_SIZE (1 << 20)
+#define IO_QUEUE_DEPTH 4
+#define IO_ALIGNMENT 4096
+#define ARENA_BLOCK_SIZE (256 * 1024)
+#define ARENA_LARGE_SIZE (64 * 1024)
+#define ARENA_MAX_BLOCK_SIZE (4 * 1024 * 1024)
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024)
+#define ROW_GROUP_SIZE 65536
+#define NUMBER_TEXT_SIZE 32
+#define VIEW_BATCH_SIZE 4096
+#define FILTER_SAMPLE_SIZE 1024
+#define CLUSTER_TAIL_SIZE 4096
+#define PIVOT_MAX_COLUMNS 1024
+#define RESAMPLE_MAX_BUCKETS (1 << 24)
+
+#define VERSION "1.0.0"
+#define SOFTWARE_NAME "RowDB"
+
+// Utility functions
+std::vector<std::string> split(const std::string &s, char delimiter);
+void splitFields(const char* begin, const char* end, char delimiter, std::vector<std::string> &fields);
+std::string trim(const std::string &s);
+std::string toLower(const std::string &s);
+bool isNumber(const std::string &s);
+bool parseUnsigned(const std::string &s, size_t &value);
+bool parseNumber(const char* begin, const char* end, double &value);
+size_t formatNumber(double value, char* out);
+void appendUnsigned(std::string &out, uint64_t value);
+bool parseTimestamp(const char* begin, const char* end, int64_t &value);
+size_t formatTimestamp(int64_t value, char* out);
+int64_t daysFromCivil(int64_t year, unsigned month, unsigned day);
+void civilFromDays(int64_t days, int64_t &year, unsigned &month, unsigned &day);
+bool fileExists(const std::string &filename);
+void writeFileWith(const std::string &filename, size_t size, const std::function<void(char*)> &fill);
+std::vector<std::string> expandPattern(const std::string &pattern);
+size_t workerCount(size_t tasks);
+void parallelFor(size_t count, const std::function<void(size_t)> &body);
+std::vector<size_t> sampleRowNumbers(size_t total, size_t count, uint64_t seed);
+
+// StringRef is the 16-byte header stored for every cell: the length, the
+// first four bytes of the value, and then either the rest of the value
+// inline (values of up to 12 bytes) or a pointer to the full value in the
+// column's arena. Most comparisons are decided by the first eight bytes.
+struct StringRef {
+    static const uint32_t INLINE_LENGTH = 12;
+    
+    uint32_t length;
+    char prefix[4];
+    union {
+        char inlined[8];
+        const char* pointer;
+    };
+    
+    const char* data() const { return length <= INLINE_LENGTH ? prefix : pointer; }
+    
+    // Cells of typed columns keep their binary value in the last 8 bytes
+    double number() const {
+        double v;
+        std::memcpy(&v, inlined, sizeof(v));
+        return v;
+    }
+    
+    int64_t integer() const {
+        int64_t v;
+        std::memcpy(&v, inlined, sizeof(v));
+        return v;
+    }
+    
+    static StringRef fromInteger(int64_t v) {
+        StringRef ref;
+        std::memset(&ref, 0, sizeof(ref));
+        ref.length = sizeof(v);
+        std::memcpy(ref.inlined, &v, sizeof(v));
+        return ref;
+    }
+    
+    static StringRef fromNumber(double v) {
+        StringRef ref;
+        std::memset(&ref, 0, sizeof(ref));
+        ref.length = sizeof(v);
+        std::memcpy(ref.inlined, &v, sizeof(v));
+        return ref;
+    }
+    
+    uint64_t head() const {
+        uint64_t v;
+        std::memcpy(&v, this, sizeof(v));
+        return v;
+    }
+    
+    bool operator==(const StringRef &other) const {
+        if (head() != other.head()) return false;
+        if (length <= INLINE_LENGTH) return std::memcmp(inlined, other.inlined, 8) == 0;
+        return std::memcmp(pointer + 4, other.pointer + 4, length - 4) == 0;
+    }
+    bool operator!=(const StringRef &other) const { return !(*this == other); }
+    
+    // Three-way byte-wise comparison, resolved on the prefix when it differs
+    int compare(const StringRef &other) const {
+        uint32_t common = std::min(length, other.length);
+        int result = std::memcmp(prefix, other.prefix, std::min<uint32_t>(common, 4));
+        if (result == 0 && common > 4) {
+            result = std::memcmp(data() + 4, other.data() + 4, common - 4);
+        }
+        if (result != 0) return result;
+        return length < other.length ? -1 : (length > other.length ? 1 : 0);
+    }
+    bool operator<(const StringRef &other) const { return compare(other) < 0; }
+};
+
+// PageAllocator provides large buffers; on Linux, buffers of HUGE_PAGE_SIZE bytes or more
+// are mapped on huge page boundaries and placed by the --numa policy
+class PageAllocator {
+public:
+    enum NumaMode { NUMA_OFF, NUMA_INTERLEAVE, NUMA_BIND };
+    
+    static void setNumaPolicy(NumaMode mode, int node) {
+        numaNode() = node;
+        numaMode() = mode;
+    }
+    
+    static NumaMode getNumaMode() { return static_cast<NumaMode>(numaMode().load()); }
+    static int getNumaNode() { return numaNode(); }
+    
+    // Number of NUMA nodes the kernel reports online
+    static int nodeCount() {
+        std::ifstream file("/sys/devices/system/node/online");
+        std::string line;
+        int highest = 0;
+        if (std::getline(file, line)) {
+            for (const auto& range : split(line, ',')) {
+                size_t dash = range.find('-');
+                std::string last = dash == std::string::npos ? range : range.substr(dash + 1);
+                size_t node;
+                if (parseUnsigned(last, node)) highest = std::max(highest, static_cast<int>(node));
+            }
+        }
+        return highest + 1;
+    }
+    
+    static void* allocate(size_t bytes) {
+#ifndef _WIN32
+        if (bytes >= HUGE_PAGE_SIZE) {
+            size_t length = roundUp(bytes);
+            void* mem = mmap(nullptr, length + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (mem == MAP_FAILED) throw std::bad_alloc();
+            // Trim the mapping to a huge page aligned range
+            char* raw = static_cast<char*>(mem);
+            char* aligned = raw + (HUGE_PAGE_SIZE - reinterpret_cast<uintptr_t>(raw) % HUGE_PAGE_SIZE) % HUGE_PAGE_SIZE;
+            if (aligned > raw) munmap(raw, aligned - raw);
+            size_t tail = (raw + length + HUGE_PAGE_SIZE) - (aligned + length);
+            if (tail > 0) munmap(aligned + length, tail);
+#ifdef MADV_HUGEPAGE
+            madvise(aligned, length, MADV_HUGEPAGE);
+#endif
+            applyNumaPolicy(aligned, length);
+            return aligned;
+        }
+#endif
+        return ::operator new(bytes);
+    }
+    
+    static void release(void* p, size_t bytes) {
+#ifndef _WIN32
+        if (bytes >= HUGE_PAGE_SIZE) {
+            munmap(p, roundUp(bytes));
+            return;
+        }
+#endif
+        ::operator delete(p);
+    }
+    
+private:
+    static std::atomic<int>& numaMode() {
+        static std::atomic<int> mode(NUMA_OFF);
+        return mode;
+    }
+    
+    static std::atomic<int>& numaNode() {
+        static std::atomic<int> node(0);
+        return node;
+    }
+    
+    static size_t roundUp(size_t bytes) {
+        return (bytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+    }
+    
+    // Best effort: a failing mbind leaves the default first-touch placement
+    static void applyNumaPolicy(void* p, size_t length) {
+#ifdef ROWDB_HAVE_NUMA
+        NumaMode mode = getNumaMode();
+        if (mode == NUMA_OFF) return;
+        const size_t maskBits = 8 * sizeof(unsigned long);
+        unsigned long mask = 0;
+        if (mode == NUMA_INTERLEAVE) {
+            int nodes = std::min<int>(nodeCount(), static_cast<int>(maskBits));
+            mask = nodes >= static_cast<int>(maskBits) ? ~0UL : (1UL << nodes) - 1;
+        } else {
+            mask = 1UL << (getNumaNode() % maskBits);
+        }
+        syscall(SYS_mbind, p, length, mode == NUMA_INTERLEAVE ? MPOL_INTERLEAVE : MPOL_BIND,
+                &mask, maskBits, 0);
+#else
+        (void)p;
+        (void)length;
+#endif
+    }
+};
+
+// Arena is the memory resource shared by a table and its columns: small requests are
+// bump-allocated from large blocks and freed together, and an arena can retain the
+// arenas, or pin the buffers (such as a mapped image), whose values it references
+class Arena {
+private:
+    struct Block {
+        char* data;
+        size_t size;
+    };
+    std::vector<Block> blocks;
+    std::vector<std::shared_ptr<Arena>> retained;
+    std::vector<std::shared_ptr<const void>> pinned;
+    char* cursor;
+    size_t remaining;
+    size_t nextBlockSize;
+    
+    char* newBlock(size_t size) {
+        Block block = {static_cast<char*>(PageAllocator::allocate(size)), size};
+        blocks.push_back(block);
+        return block.data;
+    }
+    
+    Arena(const Arena&);
+    Arena& operator=(const Arena&);
+public:
+    Arena() : cursor(nullptr), remaining(0), nextBlockSize(ARENA_BLOCK_SIZE) {}
+    
+    ~Arena() {
+        for (const auto& block : blocks) {
+            PageAllocator::release(block.data, block.size);
+        }
+    }
+    
+    void* allocate(size_t bytes, size_t alignment) {
+        if (bytes >= ARENA_LARGE_SIZE) {
+            return PageAllocator::allocate(bytes);
+        }
+        size_t pad = (alignment - reinterpret_cast<uintptr_t>(cursor) % alignment) % alignment;
+        if (bytes + pad > remaining) {
+            // Blocks grow so big tables end up on huge-page sized blocks
+            cursor = newBlock(nextBlockSize);
+            remaining = nextBlockSize;
+            nextBlockSize = std::min<size_t>(nextBlockSize * 2, ARENA_MAX_BLOCK_SIZE);
+            pad = 0;
+        }
+        char* out = cursor + pad;
+        cursor += pad + bytes;
+        remaining -= pad + bytes;
+        return out;
+    }
+    
+    void deallocate(void* p, size_t bytes) {
+        if (bytes >= ARENA_LARGE_SIZE) {
+            PageAllocator::release(p, bytes);
+        }
+    }
+    
+    // Copies a cell value into the arena; it lives as long as the arena
+    const char* storeString(const char* data, size_t length) {
+        char* out;
+        if (length >= ARENA_LARGE_SIZE) {
+            out = newBlock(length);
+        } else {
+            out = static_cast<char*>(allocate(length, 1));
+        }
+        std::memcpy(out, data, length);
+        return out;
+    }
+    
+    void retain(const std::shared_ptr<Arena> &other) {
+        if (other.get() == this) return;
+        if (std::find(retained.begin(), retained.end(), other) == retained.end()) {
+            retained.push_back(other);
+        }
+    }
+    
+    void pin(const std::shared_ptr<const void> &buffer) {
+        pinned.push_back(buffer);
+    }
+};
+
+// ArenaAllocator lets standard containers allocate from an Arena
+template <typename T>
+class ArenaAllocator {
+public:
+    typedef T value_type;
+    typedef std::true_type propagate_on_container_move_assignment;
+    typedef std::true_type propagate_on_container_swap;
+    
+    Arena* arena;
+    
+    explicit ArenaAllocator(Arena* a) : arena(a) {}
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U> &other) : arena(other.arena) {}
+    
+    T* allocate(size_t n) {
+        return static_cast<T*>(arena->allocate(n * sizeof(T), alignof(T)));
+    }
+    void deallocate(T* p, size_t n) {
+        arena->deallocate(p, n * sizeof(T));
+    }
+    
+    template <typename U>
+    bool operator==(const ArenaAllocator<U> &other) const { return arena == other.arena; }
+    template <typename U>
+    bool operator!=(const ArenaAllocator<U> &other) const { return arena != other.arena; }
+};
+
+// Column value types. Text cells hold their bytes; typed cells hold a
+// binary value and are parsed and formatted at the edges. Dates are stored
+// as seconds since 1970-01-01 00:00:00 UTC.
+enum ColumnType { TYPE_TEXT, TYPE_NUMBER, TYPE_DATE };
+
+inline const char* columnTypeName(ColumnType type) {
+    switch (type) {
+        case TYPE_NUMBER: return "number";
+        case TYPE_DATE: return "date";
+        default: return "text";
+    }
+}
+
+inline bool parseColumnType(const std::string &name, ColumnType &type) {
+    if (name == "text") type = TYPE_TEXT;
+    else if (name == "number") type = TYPE_NUMBER;
+    else if (name == "date") type = TYPE_DATE;
+    else return false;
+    return true;
+}
+
+// Calendar buckets for date columns, computed with integer arithmetic
+enum TimeUnit { UNIT_MINUTE, UNIT_HOUR, UNIT_DAY, UNIT_MONTH };
+
+inline bool parseTimeUnit(const std::string &name, TimeUnit &unit) {
+    if (name == "minute") unit = UNIT_MINUTE;
+    else if (name == "hour") unit = UNIT_HOUR;
+    else if (name == "day") unit = UNIT_DAY;
+    else if (name == "month") unit = UNIT_MONTH;
+    else return false;
+    return true;
+}
+
+inline int64_t floorDiv(int64_t a, int64_t b) {
+    return a / b - ((a % b != 0) && ((a < 0) != (b < 0)));
+}
+
+// Bucket number of a timestamp: minutes, hours or days since the epoch, or
+// year * 12 + month - 1
+inline int64_t timeBucket(int64_t timestamp, TimeUnit unit) {
+    switch (unit) {
+        case UNIT_MINUTE: return floorDiv(timestamp, 60);
+        case UNIT_HOUR: return floorDiv(timestamp, 3600);
+        case UNIT_DAY: return floorDiv(timestamp, 86400);
+        default: {
+            int64_t year;
+            unsigned month, day;
+            civilFromDays(floorDiv(timestamp, 86400), year, month, day);
+            return year * 12 + month - 1;
+        }
+    }
+}
+
+// First second of a bucket
+inline int64_t bucketStart(int64_t bucket, TimeUnit unit) {
+    switch (unit) {
+        case UNIT_MINUTE: return bucket * 60;
+        case UNIT_HOUR: return bucket * 3600;
+        case UNIT_DAY: return bucket * 86400;
+        default: return daysFromCivil(floorDiv(bucket, 12), static_cast<unsigned>(bucket - floorDiv(bucket, 12) * 12 + 1), 1) * 86400;
+    }
+}
+
+// Label of a bucket: YYYY-MM for months, YYYY-MM-DD for days and
+// YYYY-MM-DD HH:MM for hours and minutes
+inline std::string bucketLabel(int64_t bucket, TimeUnit unit) {
+    char text[NUMBER_TEXT_SIZE];
+    int64_t start = bucketStart(bucket, unit);
+    size_t length = formatTimestamp(start, text);
+    if (length == 10 && unit != UNIT_MONTH && unit != UNIT_DAY) {
+        std::memcpy(text + 10, " 00:00", 6);
+        length = 16;
+    }
+    if (unit == UNIT_MONTH) length = std::min<size_t>(length, 7);
+    else if (unit == UNIT_DAY) length = std::min<size_t>(length, 10);
+    else length = std::min<size_t>(length, 16);
+    return std::string(text, length);
+}
+
+// Cell class representing a single cell in the table. A Cell is a view of
+// the column's storage and is valid until the column is modified. A
+// default-constructed Cell is NULL, which is distinct from an empty string.
+// Typed cells format their text when it is first read.
+class Cell {
+private:
+    static constexpr uint8_t UNFORMATTED = 0xFF;
+    
+    StringRef ref;
+    bool null;
+    ColumnType type;
+    mutable uint8_t textLength;
+    mutable char text[NUMBER_TEXT_SIZE];
+    
+    void format() const {
+        if (textLength != UNFORMATTED) return;
+        if (type == TYPE_NUMBER) {
+            textLength = static_cast<uint8_t>(formatNumber(ref.number(), text));
+        } else {
+            textLength = static_cast<uint8_t>(formatTimestamp(ref.integer(), text));
+        }
+    }
+public:
+    Cell() : null(true), type(TYPE_TEXT), textLength(0) { std::memset(&ref, 0, sizeof(ref)); }
+    explicit Cell(const StringRef &r, ColumnType t = TYPE_TEXT)
+        : ref(r), null(false), type(t), textLength(t == TYPE_TEXT ? 0 : UNFORMATTED) {}
+    
+    std::string getValue() const { return std::string(data(), size()); }
+    const char* data() const {
+        if (type == TYPE_TEXT) return ref.data();
+        format();
+        return text;
+    }
+    size_t size() const {
+        if (type == TYPE_TEXT) return ref.length;
+        format();
+        return textLength;
+    }
+    bool isNull() const { return null; }
+    ColumnType getType() const { return type; }
+    double getNumber() const { return ref.number(); }
+    int64_t getTimestamp() const { return ref.integer(); }
+    const StringRef& getRef() const { return ref; }
+    
+    bool operator==(const Cell &other) const {
+        if (null || other.null) return null == other.null;
+        if (type == TYPE_NUMBER && other.type == TYPE_NUMBER) return ref.number() == other.ref.number();
+        if (type == TYPE_DATE && other.type == TYPE_DATE) return ref.integer() == other.ref.integer();
+        if (type == TYPE_TEXT && other.type == TYPE_TEXT) return ref == other.ref;
+        return getValue() == other.getValue();
+    }
+    bool operator!=(const Cell &other) const { return !(*this == other); }
+    bool operator<(const Cell &other) const {
+        if (null || other.null) return null && !other.null;
+        if (type == TYPE_NUMBER && other.type == TYPE_NUMBER) return ref.number() < other.ref.number();
+        if (type == TYPE_DATE && other.type == TYPE_DATE) return ref.integer() < other.ref.integer();
+        if (type == TYPE_TEXT && other.type == TYPE_TEXT) return ref < other.ref;
+        return getValue() < other.getValue();
+    }
+    
+    friend std::ostream& operator<<(std::ostream& os, const Cell& cell) {
+        os.write(cell.data(), static_cast<std::streamsize>(cell.size()));
+        return os;
+    }
+};
+
+inline int popcount64(uint64_t word) {
+#ifdef _MSC_VER
+    return static_cast<int>(__popcnt64(word));
+#else
+    return __builtin_popcountll(word);
+#endif
+}
+
+// Index of the lowest set bit; word must not be zero
+inline int countTrailingZeros64(uint64_t word) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, word);
+    return static_cast<int>(index);
+#else
+    return __builtin_ctzll(word);
+#endif
+}
+
+// ColumnPage is one column's mini-page for one row group: a validity bitmap, the present
+// values as StringRef headers, and ranks[w], the number of values before bitmap word w
+struct ColumnPage {
+    std::vector<StringRef, ArenaAllocator<StringRef>> values;
+    std::vector<uint64_t, ArenaAllocator<uint64_t>> validity;
+    std::vector<uint32_t, ArenaAllocator<uint32_t>> ranks;
+    uint32_t rows;
+    
+    explicit ColumnPage(Arena* arena)
+        : values(ArenaAllocator<StringRef>(arena)),
+          validity(ArenaAllocator<uint64_t>(arena)),
+          ranks(ArenaAllocator<uint32_t>(arena)),
+          rows(0) {}
+    
+    ColumnPage(const ColumnPage &other, Arena* arena)
+        : values(other.values.begin(), other.values.end(), ArenaAllocator<StringRef>(arena)),
+          validity(other.validity.begin(), other.validity.end(), ArenaAllocator<uint64_t>(arena)),
+          ranks(other.ranks.begin(), other.ranks.end(), ArenaAllocator<uint32_t>(arena)),
+          rows(other.rows) {}
+    
+    bool isNull(size_t row) const {
+        return row >= rows || !((validity[row / 64] >> (row % 64)) & 1);
+    }
+    
+    // Position in values of row, which must be present
+    size_t slot(size_t row) const {
+        size_t word = row / 64;
+        uint64_t below = validity[word] & ((uint64_t(1) << (row % 64)) - 1);
+        return ranks[word] + popcount64(below);
+    }
+    
+    void append(const StringRef* ref) {
+        if (rows % 64 == 0) {
+            validity.push_back(0);
+            ranks.push_back(static_cast<uint32_t>(values.size()));
+        }
+        if (ref) {
+            values.push_back(*ref);
+            validity[rows / 64] |= uint64_t(1) << (rows % 64);
+        }
+        rows++;
+    }
+    
+    void set(size_t row, const StringRef &ref) {
+        if (!isNull(row)) {
+            values[slot(row)] = ref;
+            return;
+        }
+        values.insert(values.begin() + slot(row), ref);
+        validity[row / 64] |= uint64_t(1) << (row % 64);
+        for (size_t w = row / 64 + 1; w < ranks.size(); w++) ranks[w]++;
+    }
+    
+    void setNull(size_t row) {
+        if (isNull(row)) return;
+        values.erase(values.begin() + slot(row));
+        validity[row / 64] &= ~(uint64_t(1) << (row % 64));
+        for (size_t w = row / 64 + 1; w < ranks.size(); w++) ranks[w]--;
+    }
+    
+    // Drops every row from row on
+    void truncate(size_t row) {
+        if (row >= rows) return;
+        values.resize(slot(row));
+        validity.resize((row + 63) / 64);
+        ranks.resize(validity.size());
+        if (row % 64 != 0) validity.back() &= (uint64_t(1) << (row % 64)) - 1;
+        rows = static_cast<uint32_t>(row);
+    }
+};
+
+// PageCursor walks a column page row by row. It tracks the position of the
+// next present value, so sequential row-wise access needs no rank lookups.
+class PageCursor {
+private:
+    const ColumnPage* page;
+    ColumnType type;
+    size_t row;
+    size_t value;
+public:
+    PageCursor() : page(nullptr), type(TYPE_TEXT), row(0), value(0) {}
+    PageCursor(const ColumnPage* p, ColumnType t, size_t startRow)
+        : page(p), type(t), row(startRow), value(0) {
+        if (page && row < page->rows) value = page->slot(row);
+        else if (page) value = page->values.size();
+    }
+    
+    // Returns the cell at the current row and advances to the next row
+    Cell next() {
+        if (!page || page->isNull(row)) {
+            row++;
+            return Cell();
+        }
+        row++;
+        return Cell(page->values[value++], type);
+    }
+};
+
+// Column kernels, instantiated per value type, operator and nullability and picked once
+// per page by the dispatch tables below, so inner loops carry no per-cell switches
+enum CompareOp { OP_EQ, OP_NE, OP_LT, OP_LE, OP_GT, OP_GE, OP_LIKE };
+
+inline bool parseCompareOp(const std::string &text, CompareOp &op) {
+    if (text == "=" || text == "==") op = OP_EQ;
+    else if (text == "!=" || text == "<>") op = OP_NE;
+    else if (text == "<") op = OP_LT;
+    else if (text == "<=") op = OP_LE;
+    else if (text == ">") op = OP_GT;
+    else if (text == ">=") op = OP_GE;
+    else if (toLower(text) == "like") op = OP_LIKE;
+    else return false;
+    return true;
+}
+
+// Compiled LIKE pattern: % matches any run of bytes and _ any one byte.
+// Patterns of the forms abc, abc%, %abc and %abc% are matched with one
+// comparison or search; others use a backtracking matcher.
+struct LikePattern {
+    enum Kind { EXACT, PREFIX, SUFFIX, CONTAINS, GENERAL };
+    Kind kind;
+    std::string text;
+    
+    explicit LikePattern(const std::string &pattern) : kind(GENERAL), text(pattern) {
+        if (pattern.find('_') != std::string::npos) return;
+        bool leading = !pattern.empty() && pattern.front() == '%';
+        bool trailing = pattern.size() > static_cast<size_t>(leading) && pattern.back() == '%';
+        std::string inner = pattern.substr(leading, pattern.size() - leading - trailing);
+        if (inner.find('%') != std::string::npos) return;
+        text = inner;
+        kind = leading ? (trailing ? CONTAINS : SUFFIX) : (trailing ? PREFIX : EXACT);
+    }
+    
+    bool matches(const char* data, size_t length) const {
+        std::string_view value(data, length);
+        switch (kind) {
+            case EXACT: return value == text;
+            case PREFIX: return value.substr(0, text.size()) == text;
+            case SUFFIX: return length >= text.size() && value.substr(length - text.size()) == text;
+            case CONTAINS: return value.find(text) != std::string_view::npos;
+            default: return matchGeneral(value);
+        }
+    }
+    
+private:
+    // Wildcard matching that backtracks only to the most recent %
+    bool matchGeneral(std::string_view value) const {
+        size_t p = 0, v = 0, star = std::string::npos, resume = 0;
+        while (v < value.size()) {
+            if (p < text.size() && (text[p] == '_' || text[p] == value[v])) {
+                p++;
+                v++;
+            } else if (p < text.size() && text[p] == '%') {
+                star = p++;
+                resume = v;
+            } else if (star != std::string::npos) {
+                p = star + 1;
+                v = ++resume;
+            } else {
+                return false;
+            }
+        }
+        while (p < text.size() && text[p] == '%') p++;
+        return p == text.size();
+    }
+};
+
+inline uint64_t mix64(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+const uint64_t NULL_HASH = 0x9e3779b97f4a7c15ULL;
+
+// Numbers the distinct keys of a stream of items in order of first
+// appearance. The caller hashes each item's key and decides equality; the
+// open-addressing slots are kept at most half full.
+class GroupTable {
+private:
+    static constexpr size_t NONE = std::numeric_limits<size_t>::max();
+    std::vector<size_t> slots;
+    std::vector<uint64_t> hashes;
+    std::vector<size_t> firsts;
+    
+    void grow() {
+        std::vector<size_t> larger(slots.size() * 2, NONE);
+        size_t mask = larger.size() - 1;
+        for (size_t g = 0; g < firsts.size(); g++) {
+            size_t s = hashes[g] & mask;
+            while (larger[s] != NONE) s = (s + 1) & mask;
+            larger[s] = g;
+        }
+        slots.swap(larger);
+    }
+public:
+    GroupTable() : slots(1024, NONE) {}
+    
+    size_t size() const { return firsts.size(); }
+    
+    // The item that opened a group
+    size_t first(size_t group) const { return firsts[group]; }
+    
+    // Group of item; same(a, b) tells whether items a and b have equal keys.
+    // An item unlike every earlier one opens group size() - 1.
+    template <typename Same>
+    size_t insert(uint64_t hash, size_t item, Same same) {
+        size_t mask = slots.size() - 1;
+        size_t s = hash & mask;
+        for (size_t g = slots[s]; g != NONE; g = slots[s]) {
+            if (hashes[g] == hash && same(firsts[g], item)) return g;
+            s = (s + 1) & mask;
+        }
+        size_t group = firsts.size();
+        slots[s] = group;
+        firsts.push_back(item);
+        hashes.push_back(hash);
+        if (firsts.size() * 2 > slots.size()) grow();
+        return group;
+    }
+};
+
+// Value traits: how each column type reads, sums and hashes its payload
+struct TextValue {
+    typedef StringRef Type;
+    static const StringRef& get(const StringRef &ref) { return ref; }
+    static StringRef store(const StringRef &value) { return value; }
+    static double toDouble(const StringRef&) { return 0; }
+    static uint64_t hash(const StringRef &value) {
+        return mix64(std::hash<std::string_view>()(std::string_view(value.data(), value.length)));
+    }
+};
+
+struct NumberValue {
+    typedef double Type;
+    static double get(const StringRef &ref) { return ref.number(); }
+    static StringRef store(double value) { return StringRef::fromNumber(value); }
+    static double toDouble(double value) { return value; }
+    static uint64_t hash(double value) {
+        uint64_t bits;
+        value += 0.0; // -0.0 and 0.0 hash alike
+        std::memcpy(&bits, &value, sizeof(bits));
+        return mix64(bits);
+    }
+};
+
+struct DateValue {
+    typedef int64_t Type;
+    static int64_t get(const StringRef &ref) { return ref.integer(); }
+    static StringRef store(int64_t value) { return StringRef::fromInteger(value); }
+    static double toDouble(int64_t value) { return static_cast<double>(value); }
+    static uint64_t hash(int64_t value) { return mix64(static_cast<uint64_t>(value)); }
+};
+
+// Op is a template argument, so the switch folds to a single comparison
+template <CompareOp Op, typename T>
+inline bool compareValues(const T &a, const T &b) {
+    if constexpr (std::is_floating_point<T>::value) {
+        // NaN fails every comparison
+        if (Op == OP_LE) return a <= b;
+        if (Op == OP_GE) return a >= b;
+    }
+    switch (Op) {
+        case OP_EQ: return a == b;
+        case OP_NE: return !(a == b);
+        case OP_LT: return a < b;
+        case OP_LE: return !(b < a);
+        case OP_GT: return b < a;
+        default: return !(a < b);
+    }
+}
+
+// Writes the page rows whose value satisfies pred to out, which needs room
+// for page.rows entries; returns how many matched
+template <typename V, bool Nullable, typename Pred>
+size_t selectWhere(const ColumnPage &page, Pred pred, uint32_t* out) {
+    const StringRef* values = page.values.data();
+    size_t count = 0;
+    if (!Nullable) {
+        for (uint32_t row = 0; row < page.rows; row++) {
+            out[count] = row;
+            count += pred(V::get(values[row]));
+        }
+        return count;
+    }
+    size_t value = 0;
+    for (size_t w = 0; w < page.validity.size(); w++) {
+        for (uint64_t bits = page.validity[w]; bits; bits &= bits - 1) {
+            out[count] = static_cast<uint32_t>(w * 64 + countTrailingZeros64(bits));
+            count += pred(V::get(values[value++]));
+        }
+    }
+    return count;
+}
+
+// Like selectWhere, but tests only the given ascending page rows
+template <typename V, bool Nullable, typename Pred>
+size_t refineWhere(const ColumnPage &page, const uint32_t* rows, size_t rowCount, Pred pred, uint32_t* out) {
+    const StringRef* values = page.values.data();
+    size_t count = 0;
+    for (size_t i = 0; i < rowCount; i++) {
+        uint32_t row = rows[i];
+        if (Nullable && page.isNull(row)) continue;
+        out[count] = row;
+        count += pred(V::get(values[Nullable ? page.slot(row) : row]));
+    }
+    return count;
+}
+
+template <typename V, CompareOp Op, bool Nullable>
+size_t selectPage(const ColumnPage &page, const StringRef &constant, uint32_t* out) {
+    const typename V::Type probe = V::get(constant);
+    return selectWhere<V, Nullable>(page, [&](const typename V::Type &v) {
+        return compareValues<Op>(v, probe);
+    }, out);
+}
+
+template <typename V, CompareOp Op, bool Nullable>
+size_t refinePage(const ColumnPage &page, const uint32_t* rows, size_t rowCount,
+                  const StringRef &constant, uint32_t* out) {
+    const typename V::Type probe = V::get(constant);
+    return refineWhere<V, Nullable>(page, rows, rowCount, [&](const typename V::Type &v) {
+        return compareValues<Op>(v, probe);
+    }, out);
+}
+
+template <bool Nullable>
+size_t likePage(const ColumnPage &page, const LikePattern &pattern, uint32_t* out) {
+    return selectWhere<TextValue, Nullable>(page, [&](const StringRef &v) {
+        return pattern.matches(v.data(), v.length);
+    }, out);
+}
+
+template <bool Nullable>
+size_t likeRefinePage(const ColumnPage &page, const uint32_t* rows, size_t rowCount,
+                      const LikePattern &pattern, uint32_t* out) {
+    return refineWhere<TextValue, Nullable>(page, rows, rowCount, [&](const StringRef &v) {
+        return pattern.matches(v.data(), v.length);
+    }, out);
+}
+
+// Running count, sum, minimum and maximum of present values. The sum is
+// only meaningful for number columns; min and max are in stored form.
+struct Aggregate {
+    size_t count;
+    double sum;
+    StringRef min;
+    StringRef max;
+    
+    Aggregate() : count(0), sum(0) {
+        std::memset(&min, 0, sizeof(min));
+        std::memset(&max, 0, sizeof(max));
+    }
+};
+
+// Folds the page values at the given rows (all present values when rows is
+// null) into agg
+template <typename V, bool Nullable>
+void aggregatePage(const ColumnPage &page, const uint32_t* rows, size_t rowCount, Aggregate &agg) {
+    const StringRef* values = page.values.data();
+    size_t count = 0;
+    double sum = 0;
+    typename V::Type low{}, high{};
+    bool seeded = false;
+    auto fold = [&](const StringRef &ref) {
+        typename V::Type v = V::get(ref);
+        if (!seeded) {
+            low = high = v;
+            seeded = true;
+        }
+        sum += V::toDouble(v);
+        low = std::min(low, v);
+        high = std::max(high, v);
+        count++;
+    };
+    if (!rows) {
+        for (size_t i = 0; i < page.values.size(); i++) fold(values[i]);
+    } else if (!Nullable) {
+        for (size_t i = 0; i < rowCount; i++) fold(values[rows[i]]);
+    } else {
+        for (size_t i = 0; i < rowCount; i++) {
+            if (!page.isNull(rows[i])) fold(values[page.slot(rows[i])]);
+        }
+    }
+    if (count == 0) return;
+    if (agg.count == 0 || low < V::get(agg.min)) agg.min = V::store(low);
+    if (agg.count == 0 || V::get(agg.max) < high) agg.max = V::store(high);
+    agg.count += count;
+    agg.sum += sum;
+}
+
+// Folds one stored value into agg
+template <typename V>
+void foldValue(Aggregate &agg, const StringRef &ref) {
+    typename V::Type v = V::get(ref);
+    if (agg.count == 0 || v < V::get(agg.min)) agg.min = ref;
+    if (agg.count == 0 || V::get(agg.max) < v) agg.max = ref;
+    agg.count++;
+    agg.sum += V::toDouble(v);
+}
+
+// Folds an aggregate of other values of the same column into agg
+template <typename V>
+void mergeAggregate(Aggregate &agg, const Aggregate &partial) {
+    if (partial.count == 0) return;
+    if (agg.count == 0 || V::get(partial.min) < V::get(agg.min)) agg.min = partial.min;
+    if (agg.count == 0 || V::get(agg.max) < V::get(partial.max)) agg.max = partial.max;
+    agg.count += partial.count;
+    agg.sum += partial.sum;
+}
+
+// Writes one hash per page row to out; NULL cells hash to NULL_HASH
+template <typename V, bool Nullable>
+void hashPage(const ColumnPage &page, uint64_t* out) {
+    const StringRef* values = page.values.data();
+    if (!Nullable) {
+        for (uint32_t row = 0; row < page.rows; row++) out[row] = V::hash(V::get(values[row]));
+        return;
+    }
+    size_t value = 0;
+    for (uint32_t row = 0; row < page.rows; row++) {
+        bool present = (page.validity[row / 64] >> (row % 64)) & 1;
+        out[row] = present ? V::hash(V::get(values[value])) : NULL_HASH;
+        value += present;
+    }
+}
+
+// Copies the cells at the given page rows to out, formatting typed values
+template <bool Nullable>
+void gatherPage(const ColumnPage &page, ColumnType type, const uint32_t* rows, size_t rowCount, Cell* out) {
+    const StringRef* values = page.values.data();
+    for (size_t i = 0; i < rowCount; i++) {
+        if (!Nullable) out[i] = Cell(values[rows[i]], type);
+        else out[i] = page.isNull(rows[i]) ? Cell() : Cell(values[page.slot(rows[i])], type);
+    }
+}
+
+typedef size_t (*SelectKernel)(const ColumnPage&, const StringRef&, uint32_t*);
+typedef size_t (*RefineKernel)(const ColumnPage&, const uint32_t*, size_t, const StringRef&, uint32_t*);
+typedef size_t (*LikeKernel)(const ColumnPage&, const LikePattern&, uint32_t*);
+typedef size_t (*LikeRefineKernel)(const ColumnPage&, const uint32_t*, size_t, const LikePattern&, uint32_t*);
+typedef void (*AggregateKernel)(const ColumnPage&, const uint32_t*, size_t, Aggregate&);
+typedef void (*HashKernel)(const ColumnPage&, uint64_t*);
+typedef void (*GatherKernel)(const ColumnPage&, ColumnType, const uint32_t*, size_t, Cell*);
+
+template <typename V, bool Nullable>
+struct KernelSet {
+    static constexpr SelectKernel select[6] = {
+        selectPage<V, OP_EQ, Nullable>, selectPage<V, OP_NE, Nullable>,
+        selectPage<V, OP_LT, Nullable>, selectPage<V, OP_LE, Nullable>,
+        selectPage<V, OP_GT, Nullable>, selectPage<V, OP_GE, Nullable>
+    };
+    static constexpr RefineKernel refine[6] = {
+        refinePage<V, OP_EQ, Nullable>, refinePage<V, OP_NE, Nullable>,
+        refinePage<V, OP_LT, Nullable>, refinePage<V, OP_LE, Nullable>,
+        refinePage<V, OP_GT, Nullable>, refinePage<V, OP_GE, Nullable>
+    };
+    static constexpr AggregateKernel aggregate = aggregatePage<V, Nullable>;
+    static constexpr HashKernel hash = hashPage<V, Nullable>;
+};
+
+// Dispatch tables indexed by [ColumnType][nullable]
+inline SelectKernel selectKernel(ColumnType type, CompareOp op, bool nullable) {
+    static const SelectKernel* const table[3][2] = {
+        {KernelSet<TextValue, false>::select, KernelSet<TextValue, true>::select},
+        {KernelSet<NumberValue, false>::select, KernelSet<NumberValue, true>::select},
+        {KernelSet<DateValue, false>::select, KernelSet<DateValue, true>::select}
+    };
+    return table[type][nullable][op];
+}
+
+inline RefineKernel refineKernel(ColumnType type, CompareOp op, bool nullable) {
+    static const RefineKernel* const table[3][2] = {
+        {KernelSet<TextValue, false>::refine, KernelSet<TextValue, true>::refine},
+        {KernelSet<NumberValue, false>::refine, KernelSet<NumberValue, true>::refine},
+        {KernelSet<DateValue, false>::refine, KernelSet<DateValue, true>::refine}
+    };
+    return table[type][nullable][op];
+}
+
+inline LikeKernel likeKernel(bool nullable) {
+    static const LikeKernel table[2] = {likePage<false>, likePage<true>};
+    return table[nullable];
+}
+
+inline LikeRefineKernel likeRefineKernel(bool nullable) {
+    static const LikeRefineKernel table[2] = {likeRefinePage<false>, likeRefinePage<true>};
+    return table[nullable];
+}
+
+inline AggregateKernel aggregateKernel(ColumnType type, bool nullable) {
+    static const AggregateKernel table[3][2] = {
+        {KernelSet<TextValue, false>::aggregate, KernelSet<TextValue, true>::aggregate},
+        {KernelSet<NumberValue, false>::aggregate, KernelSet<NumberValue, true>::aggregate},
+        {KernelSet<DateValue, false>::aggregate, KernelSet<DateValue, true>::aggregate}
+    };
+    return table[type][nullable];
+}
+
+inline HashKernel hashKernel(ColumnType type, bool nullable) {
+    static const HashKernel table[3][2] = {
+        {KernelSet<TextValue, false>::hash, KernelSet<TextValue, true>::hash},
+        {KernelSet<NumberValue, false>::hash, KernelSet<NumberValue, true>::hash},
+        {KernelSet<DateValue, false>::hash, KernelSet<DateValue, true>::hash}
+    };
+    return table[type][nullable];
+}
+
+inline GatherKernel gatherKernel(bool nullable) {
+    static const GatherKernel table[2] = {gatherPage<false>, gatherPage<true>};
+    return table[nullable];
+}
+
+// A mutex that copies as a fresh, unlocked one, so value types can hold it
+struct MemberMutex {
+    std::mutex mutex;
+    MemberMutex() {}
+    MemberMutex(const MemberMutex&) {}
+    MemberMutex& operator=(const MemberMutex&) { return *this; }
+};
+
+// CrackerIndex is an adaptive index over one column (database cracking): each lookup
+// partitions a copy of the values around its bounds, so repeated filters converge to sorted order
+class CrackerBase {
+public:
+    virtual ~CrackerBase() {}
+    virtual size_t pieceCount() const = 0;
+};
+
+template <typename V>
+class CrackerIndex : public CrackerBase {
+private:
+    typedef typename V::Type T;
+    struct Entry {
+        T key;
+        size_t row;
+    };
+    // A bound splits entries with key < value from the rest, or with
+    // key <= value when inclusive; at equal values the strict bound sorts
+    // first
+    typedef std::pair<T, bool> Bound;
+    struct BoundLess {
+        bool operator()(const Bound &a, const Bound &b) const {
+            if (a.first < b.first) return true;
+            if (b.first < a.first) return false;
+            return !a.second && b.second;
+        }
+    };
+    
+    std::vector<Entry> entries;
+    std::map<Bound, size_t, BoundLess> bounds;
+    
+    static bool below(const T &key, const Bound &bound) {
+        return bound.second ? !(bound.first < key) : key < bound.first;
+    }
+    
+    // Position of bound: entries before it are below it, entries from it on
+    // are not. Partitions the piece containing the bound if it is new.
+    size_t crack(const Bound &bound) {
+        auto it = bounds.lower_bound(bound);
+        if (it != bounds.end() && !BoundLess()(bound, it->first)) return it->second;
+        size_t end = it == bounds.end() ? entries.size() : it->second;
+        size_t split = it == bounds.begin() ? 0 : std::prev(it)->second;
+        // Branch-free partition: entries between split and i are never
+        // below the bound, so the unconditional swap is harmless when
+        // entry i is not below it either
+        for (size_t i = split; i < end; i++) {
+            bool isBelow = below(entries[i].key, bound);
+            std::swap(entries[split], entries[i]);
+            split += isBelow;
+        }
+        bounds.emplace(bound, split);
+        return split;
+    }
+    
+public:
+    CrackerIndex(const std::vector<ColumnPage, ArenaAllocator<ColumnPage>> &pages, size_t valueCount) {
+        entries.reserve(valueCount);
+        for (size_t p = 0; p < pages.size(); p++) {
+            const ColumnPage &page = pages[p];
+            size_t value = 0;
+            for (size_t w = 0; w < page.validity.size(); w++) {
+                for (uint64_t bits = page.validity[w]; bits; bits &= bits - 1) {
+                    T key = V::get(page.values[value++]);
+                    // NaN matches no comparison, so it never needs to be found
+                    if (!(key == key)) continue;
+                    entries.push_back({key, p * ROW_GROUP_SIZE + w * 64 + countTrailingZeros64(bits)});
+                }
+            }
+        }
+    }
+    
+    size_t pieceCount() const { return bounds.size() + 1; }
+    
+    // Appends the rows whose value satisfies op against value, ascending;
+    // op must not be OP_NE or OP_LIKE
+    void select(CompareOp op, const T &value, size_t rowCount, std::vector<size_t> &out) {
+        if constexpr (std::is_floating_point<T>::value) {
+            // NaN fails every comparison, as in the scan kernels
+            if (value != value) return;
+        }
+        size_t begin = 0, end = entries.size();
+        switch (op) {
+            case OP_EQ:
+                begin = crack(Bound(value, false));
+                end = crack(Bound(value, true));
+                break;
+            case OP_LT: end = crack(Bound(value, false)); break;
+            case OP_LE: end = crack(Bound(value, true)); break;
+            case OP_GT: begin = crack(Bound(value, true)); break;
+            default: begin = crack(Bound(value, false)); break;
+        }
+        size_t count = end - begin;
+        if (count * 16 < rowCount) {
+            // Few matches: sort their row numbers
+            size_t first = out.size();
+            for (size_t i = begin; i < end; i++) out.push_back(entries[i].row);
+            std::sort(out.begin() + first, out.end());
+            return;
+        }
+        // Many matches: order them through a row bitmap
+        std::vector<uint64_t> bitmap((rowCount + 63) / 64, 0);
+        for (size_t i = begin; i < end; i++) {
+            bitmap[entries[i].row / 64] |= uint64_t(1) << (entries[i].row % 64);
+        }
+        for (size_t w = 0; w < bitmap.size(); w++) {
+            for (uint64_t bits = bitmap[w]; bits; bits &= bits - 1) {
+                out.push_back(w * 64 + countTrailingZeros64(bits));
+            }
+        }
+    }
+};
+
+// Column class representing a column in the table, split into one ColumnPage per
+// row group (PAX layout); long values live in the table's arena
+class Column {
+private:
+    std::string name;
+    ColumnType type;
+    std::shared_ptr<Arena> arena;
+    std::vector<ColumnPage, ArenaAllocator<ColumnPage>> pages;
+    size_t rows;
+    size_t valueCount;
+    // Built by the second range or equality select, so a column filtered
+    // once costs one scan, and dropped on any change. Selects are const and
+    // may run concurrently on a shared table, so they touch both only under
+    // crackMutex; changes to the column need exclusive access anyway.
+    mutable std::shared_ptr<CrackerBase> cracker;
+    mutable size_t rangeSelects;
+    mutable MemberMutex crackMutex;
+    
+    // Builds the stored form of a value given as text, parsing it for
+    // typed columns. Without copy, long text keeps pointing at data.
+    StringRef makeRef(const char* data, size_t length, bool copy = true) const {
+        if (type == TYPE_NUMBER) {
+            double number;
+            if (!parseNumber(data, data + length, number)) {
+                throw std::runtime_error("Invalid number in column " + name + ": '" +
+                                         std::string(data, length) + "'");
+            }
+            return StringRef::fromNumber(number);
+        }
+        if (type == TYPE_DATE) {
+            int64_t timestamp;
+            if (!parseTimestamp(data, data + length, timestamp)) {
+                throw std::runtime_error("Invalid date in column " + name + ": '" +
+                                         std::string(data, length) + "'");
+            }
+            return StringRef::fromInteger(timestamp);
+        }
+        if (length > UINT32_MAX) {
+            throw std::runtime_error("Cell value too long in column " + name);
+        }
+        StringRef ref;
+        std::memset(&ref, 0, sizeof(ref));
+        ref.length = static_cast<uint32_t>(length);
+        if (length <= StringRef::INLINE_LENGTH) {
+            std::memcpy(ref.prefix, data, length);
+        } else {
+            std::memcpy(ref.prefix, data, 4);
+            ref.pointer = copy ? arena->storeString(data, length) : data;
+        }
+        return ref;
+    }
+    
+    void dropIndex() {
+        cracker.reset();
+        rangeSelects = 0;
+    }
+    
+    template <typename V>
+    void crackedSelect(CompareOp op, const StringRef &constant, std::vector<size_t> &out) const {
+        if (!cracker) cracker = std::make_shared<CrackerIndex<V>>(pages, valueCount);
+        static_cast<CrackerIndex<V>&>(*cracker).select(op, V::get(constant), rows, out);
+    }
+    
+    LikePattern likePattern(const std::string &pattern) const {
+        if (type != TYPE_TEXT) {
+            throw std::runtime_error("LIKE needs a text column: " + name);
+        }
+        return LikePattern(pattern);
+    }
+    
+    // Appends a row; ref must already live in this column's arena
+    void appendRef(const StringRef* ref) {
+        dropIndex();
+        if (rows / ROW_GROUP_SIZE == pages.size()) {
+            openPage();
+        }
+        pages[rows / ROW_GROUP_SIZE].append(ref);
+        rows++;
+        if (ref) valueCount++;
+    }
+    
+    // A row's place in the order of a cluster key: NULLs first, then NaN,
+    // then values ascending, so every comparison matches one contiguous
+    // range. rank tells the three apart.
+    template <typename V>
+    struct SortKey {
+        int rank;
+        typename V::Type value;
+        size_t row;
+        bool operator<(const SortKey &other) const {
+            if (rank != other.rank || rank < 2) return rank < other.rank;
+            return value < other.value;
+        }
+    };
+
+    template <typename T>
+    static bool isNaN(const T &value) {
+        if constexpr (std::is_floating_point<T>::value) return value != value;
+        return false;
+    }
+
+    template <typename V>
+    SortKey<V> sortKey(size_t row) const {
+        SortKey<V> key = {0, typename V::Type(), row};
+        const ColumnPage &p = pages[row / ROW_GROUP_SIZE];
+        size_t local = row % ROW_GROUP_SIZE;
+        if (p.isNull(local)) return key;
+        key.value = V::get(p.values[p.slot(local)]);
+        key.rank = isNaN(key.value) ? 1 : 2;
+        return key;
+    }
+
+    // First position in [lo, hi) where pred turns false; pred must be true
+    // on a prefix of the range
+    template <typename Pred>
+    static size_t partitionPoint(size_t lo, size_t hi, Pred pred) {
+        while (lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
+            if (pred(mid)) lo = mid + 1;
+            else hi = mid;
+        }
+        return lo;
+    }
+
+    template <typename V>
+    std::vector<size_t> keyOrderOf(size_t sortedRows) const {
+        std::vector<SortKey<V>> keys(rows);
+        for (size_t i = 0; i < rows; i++) keys[i] = sortKey<V>(i);
+        std::stable_sort(keys.begin() + sortedRows, keys.end());
+        std::inplace_merge(keys.begin(), keys.begin() + sortedRows, keys.end());
+        std::vector<size_t> order(rows);
+        for (size_t i = 0; i < rows; i++) order[i] = keys[i].row;
+        return order;
+    }
+
+    template <typename V>
+    void sortRowsOf(std::vector<size_t>::iterator first, std::vector<size_t>::iterator last,
+                    bool descending, std::vector<uint8_t>::iterator ties) const {
+        std::vector<SortKey<V>> keys;
+        keys.reserve(last - first);
+        for (auto it = first; it != last; ++it) keys.push_back(sortKey<V>(*it));
+        if (descending) {
+            std::stable_sort(keys.begin(), keys.end(), [](const SortKey<V> &a, const SortKey<V> &b) { return b < a; });
+        } else {
+            std::stable_sort(keys.begin(), keys.end());
+        }
+        for (size_t i = 0; i < keys.size(); i++) {
+            first[i] = keys[i].row;
+            ties[i] = i > 0 && !(keys[i - 1] < keys[i]) && !(keys[i] < keys[i - 1]);
+        }
+    }
+
+    template <typename V>
+    size_t sortedPrefixOf() const {
+        if (rows == 0) return 0;
+        SortKey<V> last = sortKey<V>(0);
+        for (size_t i = 1; i < rows; i++) {
+            SortKey<V> key = sortKey<V>(i);
+            if (key < last) return i;
+            last = key;
+        }
+        return rows;
+    }
+
+    template <typename V>
+    std::pair<size_t, size_t> sortedRangeOf(CompareOp op, const StringRef &constant, size_t last) const {
+        typename V::Type c = V::get(constant);
+        if (isNaN(c)) return std::make_pair(size_t(0), size_t(0));
+        size_t valueStart = partitionPoint(0, last, [&](size_t i) { return sortKey<V>(i).rank < 2; });
+        size_t lower = partitionPoint(valueStart, last, [&](size_t i) { return sortKey<V>(i).value < c; });
+        size_t upper = partitionPoint(lower, last, [&](size_t i) { return !(c < sortKey<V>(i).value); });
+        switch (op) {
+            case OP_EQ: return std::make_pair(lower, upper);
+            case OP_LT: return std::make_pair(valueStart, lower);
+            case OP_LE: return std::make_pair(valueStart, upper);
+            case OP_GT: return std::make_pair(upper, last);
+            default: return std::make_pair(lower, last);
+        }
+    }
+
+    template <typename V>
+    static void mergeJoinOf(const Column &a, const Column &b, std::vector<size_t> &left, std::vector<size_t> &right) {
+        // NULL and NaN keys sort first and never join
+        size_t i = partitionPoint(0, a.rows, [&](size_t k) { return a.sortKey<V>(k).rank < 2; });
+        size_t j = partitionPoint(0, b.rows, [&](size_t k) { return b.sortKey<V>(k).rank < 2; });
+        while (i < a.rows && j < b.rows) {
+            typename V::Type ka = a.sortKey<V>(i).value;
+            typename V::Type kb = b.sortKey<V>(j).value;
+            if (ka < kb) {
+                i++;
+            } else if (kb < ka) {
+                j++;
+            } else {
+                size_t iEnd = i + 1, jEnd = j + 1;
+                while (iEnd < a.rows && !(ka < a.sortKey<V>(iEnd).value)) iEnd++;
+                while (jEnd < b.rows && !(kb < b.sortKey<V>(jEnd).value)) jEnd++;
+                for (size_t l = i; l < iEnd; l++) {
+                    for (size_t r = j; r < jEnd; r++) {
+                        left.push_back(l);
+                        right.push_back(r);
+                    }
+                }
+                i = iEnd;
+                j = jEnd;
+            }
+        }
+    }
+
+    // Splits ascending rows into per-page batches of page-local row numbers
+    template <typename Fn>
+    void forEachPageBatch(const std::vector<size_t> &rowList, Fn fn) const {
+        std::vector<uint32_t> local;
+        size_t i = 0;
+        while (i < rowList.size() && rowList[i] < rows) {
+            size_t p = rowList[i] / ROW_GROUP_SIZE;
+            size_t base = p * ROW_GROUP_SIZE;
+            local.clear();
+            for (; i < rowList.size() && rowList[i] < base + pages[p].rows; i++) {
+                local.push_back(static_cast<uint32_t>(rowList[i] - base));
+            }
+            fn(pages[p], base, local.data(), local.size());
+        }
+    }
+public:
+    Column() : Column("") {} // Default constructor
+    Column(const std::string &colName) : Column(colName, std::make_shared<Arena>()) {}
+    Column(const std::string &colName, const std::shared_ptr<Arena> &tableArena)
+        : name(colName), type(TYPE_TEXT), arena(tableArena),
+          pages(ArenaAllocator<ColumnPage>(arena.get())),
+          rows(0), valueCount(0), rangeSelects(0) {}
+    
+    // Copies the cell headers into target; long values are shared with the
+    // source column, whose arena target keeps alive
+    Column(const Column &other, const std::shared_ptr<Arena> &target)
+        : name(other.name), type(other.type), arena(target),
+          pages(ArenaAllocator<ColumnPage>(arena.get())),
+          rows(other.rows), valueCount(other.valueCount), rangeSelects(0) {
+        arena->retain(other.arena);
+        pages.reserve(other.pages.size());
+        for (const auto& page : other.pages) {
+            pages.emplace_back(page, arena.get());
+        }
+    }
+    
+    Column(const Column &other) : Column(other, std::make_shared<Arena>()) {}
+    Column(Column&&) = default;
+    
+    // Swapping keeps every buffer paired with the arena it came from
+    Column& operator=(Column &&other) {
+        std::swap(name, other.name);
+        std::swap(type, other.type);
+        std::swap(arena, other.arena);
+        pages.swap(other.pages);
+        std::swap(rows, other.rows);
+        std::swap(valueCount, other.valueCount);
+        std::swap(cracker, other.cracker);
+        std::swap(rangeSelects, other.rangeSelects);
+        return *this;
+    }
+    
+    Column& operator=(const Column &other) {
+        if (this != &other) {
+            Column copy(other);
+            *this = std::move(copy);
+        }
+        return *this;
+    }
+    
+    std::string getName() const { return name; }
+    void setName(const std::string &colName) { name = colName; }
+    
+    size_t size() const { return rows; }
+    size_t nullCount() const { return rows - valueCount; }
+    
+    ColumnType getType() const { return type; }
+    
+    // Whether range and equality selects go through a cracker index
+    static std::atomic<bool>& crackingEnabled() {
+        static std::atomic<bool> enabled(true);
+        return enabled;
+    }
+    
+    // Pieces the cracker index has split the column into; 0 without one
+    size_t crackedPieces() const {
+        std::lock_guard<std::mutex> lock(crackMutex.mutex);
+        return cracker ? cracker->pieceCount() : 0;
+    }
+    
+    // Converts every value to the new type; fails without changes when a
+    // value cannot be represented
+    void setType(ColumnType newType) {
+        if (newType == type) return;
+        Column converted(name, arena);
+        converted.type = newType;
+        for (size_t p = 0; p < pages.size(); p++) {
+            converted.openPage();
+            PageCursor cursor(&pages[p], type, 0);
+            for (size_t i = 0; i < pages[p].rows; i++) {
+                Cell cell = cursor.next();
+                if (cell.isNull()) converted.addNull();
+                else converted.addCell(cell.data(), cell.size());
+            }
+        }
+        *this = std::move(converted);
+    }
+    
+    size_t pageCount() const { return pages.size(); }
+    const ColumnPage& page(size_t index) const { return pages[index]; }
+    
+    // Starts the page of the next row group, sized like the previous one
+    void openPage() {
+        size_t expected = pages.empty() ? 64 : std::max<size_t>(64, pages.back().values.size());
+        pages.emplace_back(arena.get());
+        pages.back().values.reserve(expected);
+        pages.back().validity.reserve(pages.size() > 1 ? ROW_GROUP_SIZE / 64 : 1);
+        pages.back().ranks.reserve(pages.size() > 1 ? ROW_GROUP_SIZE / 64 : 1);
+    }
+    
+    bool isNull(size_t index) const {
+        return index >= rows || pages[index / ROW_GROUP_SIZE].isNull(index % ROW_GROUP_SIZE);
+    }
+    
+    Cell operator[](size_t index) const {
+        if (isNull(index)) {
+            return Cell();
+        }
+        const ColumnPage &p = pages[index / ROW_GROUP_SIZE];
+        return Cell(p.values[p.slot(index % ROW_GROUP_SIZE)], type);
+    }
+    
+    void addCell(const char* data, size_t length) {
+        StringRef ref = makeRef(data, length);
+        appendRef(&ref);
+    }
+    
+    void addCell(const std::string &value) {
+        addCell(value.data(), value.size());
+    }
+    
+    void addNull() {
+        appendRef(nullptr);
+    }
+    
+    // Counts the rows of a date column whose timestamp lies in [from, to]
+    size_t countInRange(int64_t from, int64_t to) const {
+        size_t count = 0;
+        for (const auto& p : pages) {
+            for (const auto& ref : p.values) {
+                int64_t v = ref.integer();
+                count += (v >= from) & (v <= to);
+            }
+        }
+        return count;
+    }
+    
+    // Row counts per calendar bucket of a date column
+    std::map<int64_t, size_t> countByBucket(TimeUnit unit) const {
+        std::map<int64_t, size_t> counts;
+        int64_t lastBucket = 0;
+        size_t run = 0;
+        for (const auto& p : pages) {
+            for (const auto& ref : p.values) {
+                int64_t bucket = timeBucket(ref.integer(), unit);
+                if (run > 0 && bucket != lastBucket) {
+                    counts[lastBucket] += run;
+                    run = 0;
+                }
+                lastBucket = bucket;
+                run++;
+            }
+        }
+        if (run > 0) counts[lastBucket] += run;
+        return counts;
+    }
+    
+    // Appends, in ascending order, the rows whose value satisfies op
+    // against value; NULL cells never match
+    void select(CompareOp op, const std::string &value, std::vector<size_t> &out) const {
+        std::vector<uint32_t> matches(std::min<size_t>(rows, ROW_GROUP_SIZE));
+        if (op == OP_LIKE) {
+            LikePattern pattern = likePattern(value);
+            for (size_t p = 0; p < pages.size(); p++) {
+                const ColumnPage &page = pages[p];
+                size_t count = likeKernel(page.values.size() != page.rows)(page, pattern, matches.data());
+                for (size_t i = 0; i < count; i++) out.push_back(p * ROW_GROUP_SIZE + matches[i]);
+            }
+            return;
+        }
+        StringRef constant = makeRef(value.data(), value.size(), false);
+        if (op != OP_NE && crackingEnabled()) {
+            std::lock_guard<std::mutex> lock(crackMutex.mutex);
+            if (cracker || ++rangeSelects > 1) {
+                switch (type) {
+                    case TYPE_NUMBER: crackedSelect<NumberValue>(op, constant, out); break;
+                    case TYPE_DATE: crackedSelect<DateValue>(op, constant, out); break;
+                    default: crackedSelect<TextValue>(op, constant, out); break;
+                }
+                return;
+            }
+        }
+        for (size_t p = 0; p < pages.size(); p++) {
+            const ColumnPage &page = pages[p];
+            bool nullable = page.values.size() != page.rows;
+            size_t count = selectKernel(type, op, nullable)(page, constant, matches.data());
+            size_t base = p * ROW_GROUP_SIZE;
+            for (size_t i = 0; i < count; i++) out.push_back(base + matches[i]);
+        }
+    }
+    
+    // Like select, but tests only the ascending candidate rows
+    void refine(CompareOp op, const std::string &value, const std::vector<size_t> &candidates,
+                std::vector<size_t> &out) const {
+        std::vector<uint32_t> matches;
+        if (op == OP_LIKE) {
+            LikePattern pattern = likePattern(value);
+            forEachPageBatch(candidates, [&](const ColumnPage &page, size_t base, const uint32_t* local, size_t count) {
+                matches.resize(count);
+                size_t found = likeRefineKernel(page.values.size() != page.rows)(page, local, count, pattern, matches.data());
+                for (size_t i = 0; i < found; i++) out.push_back(base + matches[i]);
+            });
+            return;
+        }
+        StringRef constant = makeRef(value.data(), value.size(), false);
+        forEachPageBatch(candidates, [&](const ColumnPage &page, size_t base, const uint32_t* local, size_t count) {
+            matches.resize(count);
+            size_t found = refineKernel(type, op, page.values.size() != page.rows)(page, local, count, constant, matches.data());
+            for (size_t i = 0; i < found; i++) out.push_back(base + matches[i]);
+        });
+    }
+    
+    Aggregate aggregate() const {
+        Aggregate agg;
+        for (const auto& page : pages) {
+            aggregateKernel(type, false)(page, nullptr, 0, agg);
+        }
+        return agg;
+    }
+    
+    // Aggregates the present values at rows, which must be ascending
+    Aggregate aggregate(const std::vector<size_t> &rowList) const {
+        Aggregate agg;
+        forEachPageBatch(rowList, [&](const ColumnPage &page, size_t, const uint32_t* local, size_t count) {
+            aggregateKernel(type, page.values.size() != page.rows)(page, local, count, agg);
+        });
+        return agg;
+    }
+    
+    // Folds the value at row into agg; a NULL leaves it unchanged
+    void accumulate(size_t row, Aggregate &agg) const {
+        const StringRef* value = valueAt(row);
+        if (!value) return;
+        switch (type) {
+            case TYPE_NUMBER: foldValue<NumberValue>(agg, *value); break;
+            case TYPE_DATE: foldValue<DateValue>(agg, *value); break;
+            default: foldValue<TextValue>(agg, *value); break;
+        }
+    }
+    
+    // Folds an aggregate of other rows of this column into agg
+    void combine(Aggregate &agg, const Aggregate &partial) const {
+        switch (type) {
+            case TYPE_NUMBER: mergeAggregate<NumberValue>(agg, partial); break;
+            case TYPE_DATE: mergeAggregate<DateValue>(agg, partial); break;
+            default: mergeAggregate<TextValue>(agg, partial); break;
+        }
+    }
+    
+    // One hash per row, equal for equal values
+    void hash(std::vector<uint64_t> &out) const {
+        out.resize(rows);
+        for (size_t p = 0; p < pages.size(); p++) {
+            const ColumnPage &page = pages[p];
+            hashKernel(type, page.values.size() != page.rows)(page, out.data() + p * ROW_GROUP_SIZE);
+        }
+    }
+    
+    // Materializes the cells at rows, which must be ascending
+    void gather(const std::vector<size_t> &rowList, std::vector<Cell> &out) const {
+        size_t start = out.size();
+        out.resize(start + rowList.size());
+        Cell* dest = out.data() + start;
+        forEachPageBatch(rowList, [&](const ColumnPage &page, size_t, const uint32_t* local, size_t count) {
+            gatherKernel(page.values.size() != page.rows)(page, type, local, count, dest);
+            dest += count;
+        });
+    }
+    
+    // Like gather, for rows in any order and with repeats, as a join
+    // produces them
+    void gatherUnordered(const std::vector<size_t> &rowList, std::vector<Cell> &out) const {
+        if (std::is_sorted(rowList.begin(), rowList.end())) {
+            gather(rowList, out);
+            return;
+        }
+        std::vector<size_t> order(rowList.size());
+        for (size_t i = 0; i < order.size(); i++) order[i] = i;
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return rowList[a] < rowList[b]; });
+        std::vector<size_t> sorted(rowList.size());
+        for (size_t i = 0; i < order.size(); i++) sorted[i] = rowList[order[i]];
+        std::vector<Cell> cells;
+        gather(sorted, cells);
+        size_t start = out.size();
+        out.resize(start + cells.size());
+        for (size_t i = 0; i < order.size(); i++) out[start + order[i]] = cells[i];
+    }
+    
+    // Whether row holds the same value as otherRow of other, a column of the
+    // same type; NULL equals nothing
+    bool equalValues(size_t row, const Column &other, size_t otherRow) const {
+        if (isNull(row) || other.isNull(otherRow)) return false;
+        const ColumnPage &p = pages[row / ROW_GROUP_SIZE];
+        const ColumnPage &q = other.pages[otherRow / ROW_GROUP_SIZE];
+        const StringRef &a = p.values[p.slot(row % ROW_GROUP_SIZE)];
+        const StringRef &b = q.values[q.slot(otherRow % ROW_GROUP_SIZE)];
+        switch (type) {
+            case TYPE_NUMBER: return a.number() == b.number();
+            case TYPE_DATE: return a.integer() == b.integer();
+            default: return a == b;
+        }
+    }
+    
+    // The stored value at row, or null for a NULL cell
+    const StringRef* valueAt(size_t row) const {
+        if (isNull(row)) return nullptr;
+        const ColumnPage &p = pages[row / ROW_GROUP_SIZE];
+        return &p.values[p.slot(row % ROW_GROUP_SIZE)];
+    }
+    
+    // Whether two rows belong to the same group: NULL matches NULL
+    bool sameKey(size_t row, size_t otherRow) const {
+        bool nullA = isNull(row), nullB = isNull(otherRow);
+        if (nullA || nullB) return nullA == nullB;
+        return equalValues(row, *this, otherRow);
+    }
+    
+    // Sorts the row numbers in [first, last) into key order, or its reverse
+    // when descending, keeping equal keys in their order. ties receives 1
+    // for every position whose key equals the one before it.
+    void sortRows(std::vector<size_t>::iterator first, std::vector<size_t>::iterator last,
+                  bool descending, std::vector<uint8_t>::iterator ties) const {
+        switch (type) {
+            case TYPE_NUMBER: sortRowsOf<NumberValue>(first, last, descending, ties); break;
+            case TYPE_DATE: sortRowsOf<DateValue>(first, last, descending, ties); break;
+            default: sortRowsOf<TextValue>(first, last, descending, ties); break;
+        }
+    }
+    
+    // Row order that puts the column in key order; rows before sortedRows
+    // must already be in key order, so only the rest is sorted and merged in
+    std::vector<size_t> keyOrder(size_t sortedRows) const {
+        switch (type) {
+            case TYPE_NUMBER: return keyOrderOf<NumberValue>(sortedRows);
+            case TYPE_DATE: return keyOrderOf<DateValue>(sortedRows);
+            default: return keyOrderOf<TextValue>(sortedRows);
+        }
+    }
+
+    // Number of leading rows that are in key order
+    size_t sortedPrefix() const {
+        switch (type) {
+            case TYPE_NUMBER: return sortedPrefixOf<NumberValue>();
+            case TYPE_DATE: return sortedPrefixOf<DateValue>();
+            default: return sortedPrefixOf<TextValue>();
+        }
+    }
+
+    // The rows among [0, last), which must be in key order, whose value
+    // satisfies op (=, <, <=, > or >=) against value, found by binary search
+    std::pair<size_t, size_t> sortedRange(CompareOp op, const std::string &value, size_t last) const {
+        StringRef constant = makeRef(value.data(), value.size(), false);
+        switch (type) {
+            case TYPE_NUMBER: return sortedRangeOf<NumberValue>(op, constant, last);
+            case TYPE_DATE: return sortedRangeOf<DateValue>(op, constant, last);
+            default: return sortedRangeOf<TextValue>(op, constant, last);
+        }
+    }
+
+    // Pairs up the rows of two columns in key order that hold equal
+    // values, walking both once
+    static void mergeJoin(const Column &a, const Column &b, std::vector<size_t> &left, std::vector<size_t> &right) {
+        if (a.type != b.type) {
+            throw std::runtime_error("Cannot join " + std::string(columnTypeName(a.type)) + " column " + a.name +
+                                     " with " + columnTypeName(b.type) + " column " + b.name);
+        }
+        switch (a.type) {
+            case TYPE_NUMBER: mergeJoinOf<NumberValue>(a, b, left, right); break;
+            case TYPE_DATE: mergeJoinOf<DateValue>(a, b, left, right); break;
+            default: mergeJoinOf<TextValue>(a, b, left, right); break;
+        }
+    }
+
+    // Appends rows order[first, first + count) of source, in that order.
+    // Long values are not copied; this column's arena keeps source's alive.
+    void appendRows(const Column &source, const std::vector<size_t> &order, size_t first, size_t count) {
+        if (rows == 0) type = source.type;
+        arena->retain(source.arena);
+        for (size_t i = first; i < first + count; i++) {
+            const ColumnPage &p = source.pages[order[i] / ROW_GROUP_SIZE];
+            size_t local = order[i] % ROW_GROUP_SIZE;
+            appendRef(p.isNull(local) ? nullptr : &p.values[p.slot(local)]);
+        }
+    }
+
+    // Appends a value already in stored form, e.g. a typed value read from
+    // an image
+    void addStored(const StringRef &ref) {
+        appendRef(&ref);
+    }
+    
+    // Appends a text value without copying it; long values keep pointing at
+    // data, which the caller must pin to the arena
+    void addBorrowed(const char* data, size_t length) {
+        StringRef ref = makeRef(data, length, false);
+        appendRef(&ref);
+    }
+    
+    void setCell(size_t index, const std::string &value) {
+        while (rows < index) {
+            addNull();
+        }
+        if (index == rows) {
+            addCell(value);
+            return;
+        }
+        dropIndex();
+        ColumnPage &p = pages[index / ROW_GROUP_SIZE];
+        if (p.isNull(index % ROW_GROUP_SIZE)) valueCount++;
+        p.set(index % ROW_GROUP_SIZE, makeRef(value.data(), value.size()));
+    }
+    
+    void setNull(size_t index) {
+        if (isNull(index)) return;
+        dropIndex();
+        pages[index / ROW_GROUP_SIZE].setNull(index % ROW_GROUP_SIZE);
+        valueCount--;
+    }
+    
+    void insertCell(size_t index, const std::string &value) {
+        setCell(index, value);
+    }
+    
+    // Removes row index; the rows after it move up by one
+    void removeCell(size_t index) {
+        if (index >= rows) return;
+        std::vector<Cell> tail;
+        for (size_t i = index + 1; i < rows; i++) {
+            tail.push_back((*this)[i]);
+        }
+        truncate(index);
+        for (const auto& cell : tail) {
+            appendRef(cell.isNull() ? nullptr : &cell.getRef());
+        }
+    }
+    
+    // Drops every row from index on
+    void truncate(size_t index) {
+        if (index >= rows) return;
+        dropIndex();
+        pages.erase(pages.begin() + std::min(pages.size(), (index + ROW_GROUP_SIZE - 1) / ROW_GROUP_SIZE), pages.end());
+        if (index % ROW_GROUP_SIZE != 0) {
+            pages.back().truncate(index % ROW_GROUP_SIZE);
+        }
+        rows = index;
+        valueCount = 0;
+        for (const auto& p : pages) valueCount += p.values.size();
+    }
+    
+    friend std::ostream& operator<<(std::ostream& os, const Column& col) {
+        os << col.name << ": ";
+        for (size_t i = 0; i < col.size(); i++) {
+            os << col[i] << " ";
+        }
+        return os;
+    }
+};
+
+// Table image for --publish/--attach and snapshots, native-endian with 8-byte aligned sections:
+// "RDBIMG03" | u32 nameLen | u32 columnCount | u64 rowCount | name | column names, then per
+// column u32 type | u32 flags | u64 valueCount | u64 validity[(rowCount + 63) / 64] | values,
+// text as u64 offsets[valueCount + 1] plus bytes and typed values as 8 bytes each
+#define IMAGE_MAGIC "RDBIMG03"
+#define IMAGE_CLUSTER_KEY 1
+
+// Row index sidecar (<file>.odt.idx) written by -sv <file> --index; offsets[k] is the
+// byte offset of row k * interval in the .odt file:
+//   "RDBIDX01" | u64 interval | u64 rowCount | u64 fileSize | u64 offsets[]
+#define ROW_INDEX_MAGIC "RDBIDX01"
+#define ROW_INDEX_INTERVAL 1024
+
+// ImageWriter appends to a buffer; with a null buffer it only counts bytes,
+// so the same code path computes the image size and fills it.
+class ImageWriter {
+private:
+    char* out;
+    size_t offset;
+public:
+    ImageWriter(char* buffer) : out(buffer), offset(0) {}
+    
+    size_t size() const { return offset; }
+    
+    void bytes(const void* data, size_t len) {
+        if (out && len > 0) std::memcpy(out + offset, data, len);
+        offset += len;
+    }
+    void skip(size_t len) { offset += len; }
+    void u32(uint32_t v) { bytes(&v, sizeof(v)); }
+    void u64(uint64_t v) { bytes(&v, sizeof(v)); }
+    void str(const std::string &s) {
+        u32(static_cast<uint32_t>(s.size()));
+        bytes(s.data(), s.size());
+        align();
+    }
+    void align() {
+        size_t pad = (8 - offset % 8) % 8;
+        if (out && pad > 0) std::memset(out + offset, 0, pad);
+        offset += pad;
+    }
+};
+
+// ImageReader walks an image in place and rejects truncated or corrupt input
+class ImageReader {
+private:
+    const char* data;
+    size_t length;
+    size_t offset;
+public:
+    ImageReader(const char* buffer, size_t size) : data(buffer), length(size), offset(0) {}
+    
+    const char* take(size_t len) {
+        if (len > length - offset) {
+            throw std::runtime_error("Invalid image: unexpected end of data");
+        }
+        const char* p = data + offset;
+        offset += len;
+        return p;
+    }
+    uint32_t u32() { uint32_t v; std::memcpy(&v, take(sizeof(v)), sizeof(v)); return v; }
+    uint64_t u64() { uint64_t v; std::memcpy(&v, take(sizeof(v)), sizeof(v)); return v; }
+    std::string str() {
+        uint32_t len = u32();
+        std::string s(take(len), len);
+        align();
+        return s;
+    }
+    void align() {
+        size_t pad = (8 - offset % 8) % 8;
+        take(std::min(pad, length - offset));
+    }
+};
+
+// MappedFile is a read-only view of a whole file. On POSIX systems the file
+// is memory-mapped so large images are paged in on demand; elsewhere it is
+// read into memory. The mapping stays valid after the file is replaced or
+// unlinked, which is what lets restored and attached tables point into it.
+class MappedFile {
+private:
+    const char* bytes;
+    size_t length;
+    std::vector<char> buffer;
+    bool mapped;
+    
+    MappedFile(const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+    
+#ifndef _WIN32
+    // Maps an open descriptor and closes it
+    void mapDescriptor(int fd, const std::string &name) {
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            close(fd);
+            throw std::runtime_error("Cannot read file: " + name);
+        }
+        length = static_cast<size_t>(st.st_size);
+        if (length > 0) {
+            void* mem = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mem != MAP_FAILED) {
+                bytes = static_cast<const char*>(mem);
+                mapped = true;
+            }
+        }
+        close(fd);
+    }
+#endif
+public:
+    explicit MappedFile(const std::string &filename) : bytes(nullptr), length(0), mapped(false) {
+#ifndef _WIN32
+        int fd = open(filename.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("Cannot open file: " + filename);
+        }
+        mapDescriptor(fd, filename);
+        if (mapped || length == 0) return;
+#endif
+        std::ifstream file(filename, std::ios::binary);
+        if (!file.is_open()) {
+            throw std::runtime_error("Cannot open file: " + filename);
+        }
+        buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        bytes = buffer.data();
+        length = buffer.size();
+    }
+    
+#ifndef _WIN32
+    // Maps a descriptor opened elsewhere, e.g. a shared memory segment
+    MappedFile(int fd, const std::string &name) : bytes(nullptr), length(0), mapped(false) {
+        mapDescriptor(fd, name);
+        if (length > 0 && !mapped) {
+            throw std::runtime_error("Cannot map: " + name);
+        }
+    }
+#endif
+    
+    ~MappedFile() {
+#ifndef _WIN32
+        if (mapped) munmap(const_cast<char*>(bytes), length);
+#endif
+    }
+    
+    const char* data() const { return bytes; }
+    size_t size() const { return length; }
+};
+
+// AlignedBuffer owns a page-aligned block used for file I/O
+class AlignedBuffer {
+private:
+    char* bytes;
+    size_t capacity;
+    
+    AlignedBuffer(const AlignedBuffer&);
+    AlignedBuffer& operator=(const AlignedBuffer&);
+public:
+    explicit AlignedBuffer(size_t size) : bytes(nullptr), capacity(size) {
+#ifdef _WIN32
+        bytes = static_cast<char*>(_aligned_malloc(size, IO_ALIGNMENT));
+#else
+        void* mem = nullptr;
+        if (posix_memalign(&mem, IO_ALIGNMENT, size) == 0) bytes = static_cast<char*>(mem);
+#endif
+        if (!bytes) throw std::bad_alloc();
+    }
+    
+    ~AlignedBuffer() {
+#ifdef _WIN32
+        _aligned_free(bytes);
+#else
+        free(bytes);
+#endif
+    }
+    
+    char* data() { return bytes; }
+    size_t size() const { return capacity; }
+};
+
+// IoQueue keeps several positional reads or writes in flight on one file, through io_uring
+// when available and pread/pwrite otherwise; completions are reported by tag
+class IoQueue {
+public:
+    struct Completion {
+        size_t tag;
+        size_t bytes;
+    };
+private:
+    struct Request {
+        bool write;
+        char* buffer;
+        size_t length;
+        uint64_t offset;
+    };
+    int fd;
+    std::string filename;
+    std::map<size_t, Request> pending;
+    std::deque<Completion> completed;
+#ifdef ROWDB_HAVE_IO_URING
+    int ringFd = -1;
+    void* sqRing = MAP_FAILED;
+    void* cqRing = MAP_FAILED;
+    size_t sqRingSize = 0;
+    size_t cqRingSize = 0;
+    io_uring_sqe* sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+    size_t sqesSize = 0;
+    unsigned *sqTail = nullptr, *sqMask = nullptr, *sqArray = nullptr;
+    unsigned *cqHead = nullptr, *cqTail = nullptr, *cqMask = nullptr;
+    io_uring_cqe* cqes = nullptr;
+    
+    bool setupRing(unsigned entries) {
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        ringFd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+        if (ringFd < 0) return false;
+        
+        sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool singleMap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (singleMap) sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+        sqRing = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ringFd, IORING_OFF_SQ_RING);
+        if (sqRing == MAP_FAILED) return false;
+        cqRing = singleMap ? sqRing : mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE,
+                                           MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_CQ_RING);
+        if (cqRing == MAP_FAILED) return false;
+        sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        sqes = static_cast<io_uring_sqe*>(mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE,
+                                               MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES));
+        if (sqes == MAP_FAILED) return false;
+        
+        char* sq = static_cast<char*>(sqRing);
+        char* cq = static_cast<char*>(cqRing);
+        sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sqMask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cqMask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        return true;
+    }
+    
+    void closeRing() {
+        if (sqes != MAP_FAILED) munmap(sqes, sqesSize);
+        if (cqRing != MAP_FAILED && cqRing != sqRing) munmap(cqRing, cqRingSize);
+        if (sqRing != MAP_FAILED) munmap(sqRing, sqRingSize);
+        if (ringFd >= 0) close(ringFd);
+        ringFd = -1;
+        sqRing = cqRing = MAP_FAILED;
+        sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+    }
+    
+    void submitToRing(size_t tag, const Request &request) {
+        unsigned tail = *sqTail;
+        unsigned index = tail & *sqMask;
+        io_uring_sqe* sqe = &sqes[index];
+        std::memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = request.write ? IORING_OP_WRITE : IORING_OP_READ;
+        sqe->fd = fd;
+        sqe->addr = reinterpret_cast<uint64_t>(request.buffer);
+        sqe->len = static_cast<uint32_t>(request.length);
+        sqe->off = request.offset;
+        sqe->user_data = tag;
+        sqArray[index] = index;
+        __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+        while (syscall(__NR_io_uring_enter, ringFd, 1, 0, 0, nullptr, 0) < 0) {
+            if (errno != EINTR) throw std::runtime_error("I/O submission failed: " + filename);
+        }
+    }
+    
+    Completion waitOnRing() {
+        while (true) {
+            unsigned head = *cqHead;
+            if (head != __atomic_load_n(cqTail, __ATOMIC_ACQUIRE)) {
+                io_uring_cqe* cqe = &cqes[head & *cqMask];
+                size_t tag = static_cast<size_t>(cqe->user_data);
+                int result = cqe->res;
+                __atomic_store_n(cqHead, head + 1, __ATOMIC_RELEASE);
+                return finish(tag, result);
+            }
+            if (syscall(__NR_io_uring_enter, ringFd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0) < 0
+                && errno != EINTR) {
+                throw std::runtime_error("I/O wait failed: " + filename);
+            }
+        }
+    }
+    
+    // Completes a ring request; errors such as an unsupported opcode and
+    // short transfers are finished synchronously
+    Completion finish(size_t tag, int result) {
+        auto it = pending.find(tag);
+        Request request = it->second;
+        pending.erase(it);
+        size_t done = result > 0 ? static_cast<size_t>(result) : 0;
+        if (result < 0 || done < request.length) {
+            done += transfer(request.write, request.buffer + done, request.length - done,
+                             request.offset + done);
+        }
+        Completion completion = {tag, done};
+        return completion;
+    }
+#endif
+    
+    // Performs a positional read or write synchronously; reads stop early
+    // only at end of file
+    size_t transfer(bool write, char* buffer, size_t length, uint64_t offset) {
+        size_t done = 0;
+        while (done < length) {
+#ifdef _WIN32
+            _lseeki64(fd, static_cast<__int64>(offset + done), SEEK_SET);
+            int n = write ? _write(fd, buffer + done, static_cast<unsigned>(length - done))
+                          : _read(fd, buffer + done, static_cast<unsigned>(length - done));
+#else
+            ssize_t n = write ? pwrite(fd, buffer + done, length - done, static_cast<off_t>(offset + done))
+                              : pread(fd, buffer + done, length - done, static_cast<off_t>(offset + done));
+            if (n < 0 && errno == EINTR) continue;
+#endif
+            if (n < 0) {
+                throw std::runtime_error(std::string(write ? "Cannot write file: " : "Cannot read file: ") + filename);
+            }
+            if (n == 0) {
+                if (write) throw std::runtime_error("Cannot write file: " + filename);
+                break;
+            }
+            done += static_cast<size_t>(n);
+        }
+        return done;
+    }
+    
+    void submit(size_t tag, const Request &request) {
+#ifdef ROWDB_HAVE_IO_URING
+        if (ringFd >= 0) {
+            pending[tag] = request;
+            submitToRing(tag, request);
+            return;
+        }
+#endif
+        Completion completion = {tag, transfer(request.write, request.buffer, request.length, request.offset)};
+        completed.push_back(completion);
+    }
+    
+    IoQueue(const IoQueue&);
+    IoQueue& operator=(const IoQueue&);
+public:
+    IoQueue(const std::string &path, bool forWriting) : fd(-1), filename(path) {
+#ifdef _WIN32
+        fd = forWriting ? _open(path.c_str(), _O_CREAT | _O_TRUNC | _O_WRONLY | _O_BINARY, _S_IREAD | _S_IWRITE)
+                        : _open(path.c_str(), _O_RDONLY | _O_BINARY);
+#else
+        fd = forWriting ? open(path.c_str(), O_CREAT | O_TRUNC | O_WRONLY, 0644)
+                        : open(path.c_str(), O_RDONLY);
+#endif
+        if (fd < 0) {
+            throw std::runtime_error(forWriting ? "Cannot open file for writing: " + path
+                                                : "Cannot open file: " + path);
+        }
+#ifdef ROWDB_HAVE_IO_URING
+        if (!setupRing(IO_QUEUE_DEPTH * 2)) closeRing();
+#endif
+    }
+    
+    ~IoQueue() {
+#ifdef ROWDB_HAVE_IO_URING
+        while (!pending.empty()) {
+            try { waitOnRing(); } catch (...) { break; }
+        }
+        closeRing();
+#endif
+#ifdef _WIN32
+        _close(fd);
+#else
+        close(fd);
+#endif
+    }
+    
+    uint64_t fileSize() const {
+#ifdef _WIN32
+        return static_cast<uint64_t>(_filelengthi64(fd));
+#else
+        struct stat st;
+        return fstat(fd, &st) == 0 ? static_cast<uint64_t>(st.st_size) : 0;
+#endif
+    }
+    
+    void submitRead(size_t tag, char* buffer, size_t length, uint64_t offset) {
+        Request request = {false, buffer, length, offset};
+        submit(tag, request);
+    }
+    
+    void submitWrite(size_t tag, const char* buffer, size_t length, uint64_t offset) {
+        Request request = {true, const_cast<char*>(buffer), length, offset};
+        submit(tag, request);
+    }
+    
+    // Blocks until any outstanding request completes
+    Completion wait() {
+        if (!completed.empty()) {
+            Completion completion = completed.front();
+            completed.pop_front();
+            return completion;
+        }
+#ifdef ROWDB_HAVE_IO_URING
+        if (!pending.empty()) return waitOnRing();
+#endif
+        throw std::logic_error("No I/O request in flight");
+    }
+};
+
+// FileReader streams a file in large blocks, keeping IO_QUEUE_DEPTH reads
+// in flight so the next blocks load while the current one is parsed
+class FileReader {
+private:
+    IoQueue queue;
+    uint64_t length;
+    uint64_t nextOffset;
+    size_t nextBlock;
+    std::vector<std::unique_ptr<AlignedBuffer>> buffers;
+    std::vector<size_t> filled;
+    std::vector<bool> ready;
+    
+    void submitNext(size_t slot) {
+        if (nextOffset >= length) return;
+        size_t len = static_cast<size_t>(std::min<uint64_t>(IO_BLOCK_SIZE, length - nextOffset));
+        ready[slot] = false;
+        queue.submitRead(slot, buffers[slot]->data(), len, nextOffset);
+        nextOffset += len;
+    }
+public:
+    explicit FileReader(const std::string &filename)
+        : queue(filename, false), length(0), nextOffset(0), nextBlock(0),
+          filled(IO_QUEUE_DEPTH, 0), ready(IO_QUEUE_DEPTH, false) {
+        length = queue.fileSize();
+        size_t blocks = static_cast<size_t>((length + IO_BLOCK_SIZE - 1) / IO_BLOCK_SIZE);
+        for (size_t slot = 0; slot < std::min<size_t>(IO_QUEUE_DEPTH, blocks); slot++) {
+            buffers.emplace_back(new AlignedBuffer(IO_BLOCK_SIZE));
+            submitNext(slot);
+        }
+    }
+    
+    uint64_t size() const { return length; }
+    
+    // Hands out the next block in file order; the bytes stay valid until the
+    // following call. Returns false at end of file.
+    bool next(const char* &data, size_t &size) {
+        if (nextBlock > 0) {
+            submitNext((nextBlock - 1) % IO_QUEUE_DEPTH);
+        }
+        if (static_cast<uint64_t>(nextBlock) * IO_BLOCK_SIZE >= length) {
+            return false;
+        }
+        size_t slot = nextBlock % IO_QUEUE_DEPTH;
+        while (!ready[slot]) {
+            IoQueue::Completion completion = queue.wait();
+            ready[completion.tag] = true;
+            filled[completion.tag] = completion.bytes;
+        }
+        data = buffers[slot]->data();
+        size = filled[slot];
+        nextBlock++;
+        return size > 0;
+    }
+};
+
+// LineReader splits a FileReader's blocks into lines. Lines are returned as
+// ranges into the block and are only copied when they straddle two blocks.
+class LineReader {
+private:
+    FileReader reader;
+    const char* pos;
+    const char* end;
+    std::string carry;
+    bool carryReturned;
+public:
+    explicit LineReader(const std::string &filename)
+        : reader(filename), pos(nullptr), end(nullptr), carryReturned(false) {}
+    
+    bool next(const char* &begin, const char* &stop) {
+        if (carryReturned) {
+            carry.clear();
+            carryReturned = false;
+        }
+        while (true) {
+            if (pos < end) {
+                const char* newline = static_cast<const char*>(std::memchr(pos, '\n', end - pos));
+                if (newline) {
+                    if (carry.empty()) {
+                        begin = pos;
+                        stop = newline;
+                    } else {
+                        carry.append(pos, newline);
+                        begin = carry.data();
+                        stop = begin + carry.size();
+                        carryReturned = true;
+                    }
+                    pos = newline + 1;
+                    if (stop > begin && stop[-1] == '\r') --stop;
+                    return true;
+                }
+                carry.append(pos, end);
+                pos = end;
+            }
+            const char* data;
+            size_t size;
+            if (!reader.next(data, size)) {
+                if (carry.empty()) return false;
+                begin = carry.data();
+                stop = begin + carry.size();
+                if (stop > begin && stop[-1] == '\r') --stop;
+                carryReturned = true;
+                return true;
+            }
+            pos = data;
+            end = data + size;
+        }
+    }
+    
+    bool next(std::string &line) {
+        const char* begin;
+        const char* stop;
+        if (!next(begin, stop)) return false;
+        line.assign(begin, stop);
+        return true;
+    }
+};
+
+// BufferLineReader splits lines out of bytes already in memory, such as a
+// MappedFile, so only the pages actually read are touched
+class BufferLineReader {
+private:
+    const char* pos;
+    const char* end;
+public:
+    BufferLineReader(const char* begin, const char* stop) : pos(begin), end(stop) {}
+    
+    const char* position() const { return pos; }
+    
+    bool next(const char* &begin, const char* &stop) {
+        if (pos >= end) return false;
+        const char* newline = static_cast<const char*>(std::memchr(pos, '\n', end - pos));
+        begin = pos;
+        stop = newline ? newline : end;
+        pos = newline ? newline + 1 : end;
+        if (stop > begin && stop[-1] == '\r') --stop;
+        return true;
+    }
+    
+    bool next(std::string &line) {
+        const char* begin;
+        const char* stop;
+        if (!next(begin, stop)) return false;
+        line.assign(begin, stop);
+        return true;
+    }
+};
+
+// FileWriter collects output into aligned blocks and writes full blocks
+// asynchronously while the caller keeps formatting
+class FileWriter {
+private:
+    IoQueue queue;
+    std::vector<std::unique_ptr<AlignedBuffer>> buffers;
+    std::vector<bool> busy;
+    size_t current;
+    size_t used;
+    uint64_t offset;
+    
+    void flushCurrent() {
+        if (used == 0) return;
+        queue.submitWrite(current, buffers[current]->data(), used, offset);
+        busy[current] = true;
+        offset += used;
+        used = 0;
+        current = (current + 1) % IO_QUEUE_DEPTH;
+        while (busy[current]) {
+            busy[queue.wait().tag] = false;
+        }
+    }
+public:
+    explicit FileWriter(const std::string &filename)
+        : queue(filename, true), busy(IO_QUEUE_DEPTH, false), current(0), used(0), offset(0) {
+        for (size_t i = 0; i < IO_QUEUE_DEPTH; i++) {
+            buffers.emplace_back(new AlignedBuffer(IO_BLOCK_SIZE));
+        }
+    }
+    
+    void write(const char* data, size_t length) {
+        while (length > 0) {
+            size_t n = std::min(length, IO_BLOCK_SIZE - used);
+            std::memcpy(buffers[current]->data() + used, data, n);
+            used += n;
+            data += n;
+            length -= n;
+            if (used == IO_BLOCK_SIZE) flushCurrent();
+        }
+    }
+    
+    void write(const std::string &data) {
+        write(data.data(), data.size());
+    }
+    
+    // Writes any buffered bytes and waits for all writes to complete
+    void finish() {
+        flushCurrent();
+        for (size_t i = 0; i < IO_QUEUE_DEPTH; i++) {
+            while (busy[i]) {
+                busy[queue.wait().tag] = false;
+            }
+        }
+    }
+};
+
+// Selection is a subset of a table's rows and columns. Only the selected
+// cells are materialized, batch by batch, when the view is rendered or
+// written. rows is ascending and 0-based; no columns means all columns.
+struct Selection {
+    bool allRows = true;
+    std::vector<size_t> rows;
+    std::vector<std::string> columns;
+    
+    bool isEverything() const { return allRows && columns.empty(); }
+};
+
+// One condition of a row filter. selectivity and cost are the planner's
+// estimates: the fraction of rows expected to pass and the relative work
+// per row tested. matched is the number of rows left after it ran.
+struct Predicate {
+    std::string column;
+    std::string opText;
+    CompareOp op = OP_EQ;
+    std::string value;
+    double selectivity = 1;
+    double cost = 1;
+    bool evaluated = false;
+    size_t matched = 0;
+    
+    std::string describe() const { return column + " " + opText + " " + value; }
+};
+
+// How many rows --sample takes: count rows, or percent of them when
+// percent is set
+struct SampleSize {
+    size_t count = 0;
+    double percent = -1;
+    
+    size_t of(size_t total) const {
+        if (percent < 0) return std::min(count, total);
+        return std::min(total, static_cast<size_t>(std::llround(static_cast<double>(total) * percent / 100)));
+    }
+};
+
+// A crosstab: one output row per distinct value of rows, one output column
+// per distinct value of cols, and in each cell function (count, sum, avg,
+// min or max) of value over the matching rows; count without a value
+// counts rows
+struct PivotSpec {
+    std::string rows;
+    std::string cols;
+    std::string function = "count";
+    std::string value;
+};
+
+// One aggregate column of --resample: function (count, sum, avg, min or
+// max) of column, or the number of rows when column is empty
+struct AggregateSpec {
+    std::string function = "count";
+    std::string column;
+    
+    std::string label() const { return function + "(" + (column.empty() ? "*" : column) + ")"; }
+};
+
+enum WindowFunction { WINDOW_ROW_NUMBER, WINDOW_RANK, WINDOW_CUMSUM, WINDOW_MOVING_AVG };
+
+// A column computed over the rows of each partition in order. source is
+// the column cumsum and moving averages read, frame the number of rows a
+// moving average spans; without partition the whole table is one partition.
+struct WindowSpec {
+    WindowFunction function = WINDOW_ROW_NUMBER;
+    std::string source;
+    size_t frame = 0;
+    std::string partition;
+    std::string order;
+    bool descending = false;
+};
+
+// Table class representing a complete table
+class Table {
+private:
+    std::string name;
+    std::shared_ptr<Arena> arena;
+    std::map<std::string, Column> columns;
+    std::vector<std::string> columnOrder;
+    // A clustered table keeps rows [0, sortedRows) in the order of its
+    // cluster key; rows appended or edited after that form an unsorted
+    // tail that is merged in once it grows
+    std::string clusterKey;
+    size_t sortedRows = 0;
+    
+    // Appends rows orders[j] of sources[j] to column j of targets, one row
+    // group at a time so the pages of a group stay side by side
+    static void appendInOrder(const std::vector<Column*> &targets, const std::vector<const Column*> &sources,
+                              const std::vector<const std::vector<size_t>*> &orders, size_t rowCount) {
+        for (size_t first = 0; first < rowCount; first += ROW_GROUP_SIZE) {
+            size_t count = std::min<size_t>(ROW_GROUP_SIZE, rowCount - first);
+            for (size_t j = 0; j < targets.size(); j++) {
+                targets[j]->appendRows(*sources[j], *orders[j], first, count);
+            }
+        }
+    }
+    
+    // Rebuilds every column so that row i is the old row order[i]
+    void reorder(const std::vector<size_t> &order) {
+        std::vector<Column> reordered;
+        std::vector<Column*> targets;
+        std::vector<const Column*> sources;
+        reordered.reserve(columnOrder.size());
+        for (const auto& colName : columnOrder) {
+            reordered.emplace_back(colName, arena);
+            targets.push_back(&reordered.back());
+            sources.push_back(&getColumn(colName));
+        }
+        appendInOrder(targets, sources, std::vector<const std::vector<size_t>*>(sources.size(), &order), order.size());
+        for (size_t j = 0; j < columnOrder.size(); j++) {
+            getColumn(columnOrder[j]) = std::move(reordered[j]);
+        }
+    }
+    
+    // Merges the tail once it outgrows CLUSTER_TAIL_SIZE rows or a 16th of
+    // the sorted rows, so each appended row costs constant merge work on
+    // average
+    void maintainCluster() {
+        if (clusterTailRows() > std::max<size_t>(CLUSTER_TAIL_SIZE, sortedRows / 16)) {
+            mergeClusterTail();
+        }
+    }
+    
+    // Takes the rows already in key order as the sorted part, e.g. after
+    // loading a file whose header names a cluster key
+    void restoreCluster() {
+        sortedRows = clusterKey.empty() ? 0 : getColumn(clusterKey).sortedPrefix();
+        maintainCluster();
+    }
+    
+    // Computes the window function for the partition rows[begin, end):
+    // sorts it by the order column, then makes one pass in that order.
+    // NULL inputs are skipped; a result without any input is NULL.
+    static void computeWindow(const WindowSpec &spec, const Column* order, const Column* source,
+                              std::vector<size_t> &rows, std::vector<uint8_t> &ties, size_t begin, size_t end,
+                              std::vector<double> &values, std::vector<uint8_t> &valid) {
+        if (order) {
+            order->sortRows(rows.begin() + begin, rows.begin() + end, spec.descending, ties.begin() + begin);
+        }
+        double sum = 0;
+        size_t count = 0, rank = 0;
+        for (size_t i = begin; i < end; i++) {
+            size_t row = rows[i];
+            size_t position = i - begin;
+            const StringRef* value = source ? source->valueAt(row) : nullptr;
+            switch (spec.function) {
+                case WINDOW_ROW_NUMBER:
+                    values[row] = static_cast<double>(position + 1);
+                    break;
+                case WINDOW_RANK:
+                    if (!ties[i]) rank = position + 1;
+                    values[row] = static_cast<double>(rank);
+                    break;
+                case WINDOW_CUMSUM:
+                    if (value) {
+                        sum += value->number();
+                        count++;
+                    }
+                    values[row] = sum;
+                    break;
+                case WINDOW_MOVING_AVG:
+                    if (value) {
+                        sum += value->number();
+                        count++;
+                    }
+                    if (position >= spec.frame) {
+                        const StringRef* leaving = source->valueAt(rows[i - spec.frame]);
+                        if (leaving) {
+                            sum -= leaving->number();
+                            count--;
+                        }
+                        if (count == 0) sum = 0;
+                    }
+                    values[row] = count > 0 ? sum / static_cast<double>(count) : 0;
+                    break;
+            }
+            valid[row] = !source || count > 0;
+        }
+    }
+    
+public:
+    Table() : Table("") {} // Default constructor
+    Table(const std::string &tableName) : name(tableName), arena(std::make_shared<Arena>()) {}
+    
+    // A copy gets its own arena for new data and shares the existing cell
+    // values with the source
+    Table(const Table &other)
+        : name(other.name), arena(std::make_shared<Arena>()), columnOrder(other.columnOrder),
+          clusterKey(other.clusterKey), sortedRows(other.sortedRows) {
+        for (const auto& pair : other.columns) {
+            columns.insert(std::make_pair(pair.first, Column(pair.second, arena)));
+        }
+    }
+    Table(Table&&) = default;
+    Table& operator=(Table&&) = default;
+    
+    Table& operator=(const Table &other) {
+        if (this != &other) {
+            Table copy(other);
+            *this = std::move(copy);
+        }
+        return *this;
+    }
+    
+    std::string getName() const { return name; }
+    void setName(const std::string &tableName) { name = tableName; }
+    
+    void addColumn(const std::string &colName) {
+        if (columns.find(colName) == columns.end()) {
+            columns.insert(std::make_pair(colName, Column(colName, arena)));
+            columnOrder.push_back(colName);
+        }
+    }
+    
+    void removeColumn(const std::string &colName) {
+        auto it = columns.find(colName);
+        if (it != columns.end()) {
+            columns.erase(it);
+            columnOrder.erase(std::remove(columnOrder.begin(), columnOrder.end(), colName), columnOrder.end());
+            if (colName == clusterKey) {
+                clusterKey.clear();
+                sortedRows = 0;
+            }
+        }
+    }
+    
+    const std::string& getClusterKey() const { return clusterKey; }
+    
+    // Rows appended or edited since the last merge of a clustered table
+    size_t clusterTailRows() const {
+        return clusterKey.empty() ? 0 : getRowCount() - sortedRows;
+    }
+    
+    // Sorts the table by colName and keeps it in that order from then on;
+    // an empty name turns clustering off and leaves the rows where they are
+    void clusterBy(const std::string &colName) {
+        if (!colName.empty() && columns.find(colName) == columns.end()) {
+            throw std::runtime_error("Column not found: " + colName);
+        }
+        clusterKey = colName;
+        sortedRows = 0;
+        mergeClusterTail();
+    }
+    
+    // Sorts the tail of a clustered table and merges it into the sorted rows
+    void mergeClusterTail() {
+        if (clusterTailRows() == 0) return;
+        reorder(getColumn(clusterKey).keyOrder(sortedRows));
+        sortedRows = getRowCount();
+    }
+    
+    Column& getColumn(const std::string &colName) {
+        auto it = columns.find(colName);
+        if (it == columns.end()) {
+            it = columns.insert(std::make_pair(colName, Column(colName, arena))).first;
+        }
+        return it->second;
+    }
+    
+    const Column& getColumn(const std::string &colName) const {
+        static Column emptyColumn("");
+        auto it = columns.find(colName);
+        if (it != columns.end()) {
+            return it->second;
+        }
+        return emptyColumn;
+    }
+    
+    std::vector<std::string> getColumnNames() const {
+        return columnOrder;
+    }
+    
+    size_t getRowCount() const {
+        if (columns.empty()) return 0;
+        return columns.begin()->second.size();
+    }
+    
+    Cell getCell(const std::string &colName, size_t rowIndex) const {
+        auto it = columns.find(colName);
+        if (it != columns.end()) {
+            return it->second[rowIndex];
+        }
+        return Cell();
+    }
+    
+    // An edited key leaves its row and every later one in the cluster tail
+    void setCell(const std::string &colName, size_t rowIndex, const std::string &value) {
+        getColumn(colName).setCell(rowIndex, value);
+        if (colName == clusterKey) {
+            sortedRows = std::min(sortedRows, rowIndex);
+            maintainCluster();
+        }
+    }
+    
+    void addRow(const std::vector<std::string> &values) {
+        if (values.size() != columnOrder.size()) {
+            throw std::runtime_error("Number of values doesn't match number of columns");
+        }
+        
+        size_t rowCount = getRowCount();
+        if (rowCount % ROW_GROUP_SIZE == 0) {
+            openRowGroup(rowCount / ROW_GROUP_SIZE);
+        }
+        for (size_t i = 0; i < columnOrder.size(); i++) {
+            getColumn(columnOrder[i]).addCell(values[i]);
+        }
+        maintainCluster();
+    }
+    
+    // Result type of an aggregate over value, which count may leave null
+    static ColumnType aggregateType(const std::string &function, const Column* value) {
+        bool numeric = function == "count" || function == "sum" || function == "avg";
+        return numeric ? TYPE_NUMBER : value->getType();
+    }
+    
+    // Appends function (count, sum, avg, min or max) of agg to target; the
+    // cell is NULL without an aggregate, or without values for all but count
+    static void appendAggregate(Column &target, const std::string &function, const Aggregate* agg) {
+        if (!agg || (function != "count" && agg->count == 0)) {
+            target.addNull();
+        } else if (function == "count") {
+            target.addStored(StringRef::fromNumber(static_cast<double>(agg->count)));
+        } else if (function == "sum") {
+            target.addStored(StringRef::fromNumber(agg->sum));
+        } else if (function == "avg") {
+            target.addStored(StringRef::fromNumber(agg->sum / static_cast<double>(agg->count)));
+        } else {
+            const StringRef &extreme = function == "min" ? agg->min : agg->max;
+            // Long text is copied, as it lives in the source table's arena
+            if (target.getType() == TYPE_TEXT) target.addCell(extreme.data(), extreme.length);
+            else target.addStored(extreme);
+        }
+    }
+    
+    // Appends a row of cells, one per column in order, keeping NULLs
+    void addCells(const std::vector<Cell> &cells) {
+        size_t rowCount = getRowCount();
+        if (rowCount % ROW_GROUP_SIZE == 0) {
+            openRowGroup(rowCount / ROW_GROUP_SIZE);
+        }
+        for (size_t i = 0; i < columnOrder.size(); i++) {
+            Column &col = getColumn(columnOrder[i]);
+            if (cells[i].isNull()) col.addNull();
+            else col.addCell(cells[i].data(), cells[i].size());
+        }
+    }
+    
+    // Appends rows in which every cell is NULL. They stay at the end of a
+    // clustered table until the next merge, so a caller can fill them in.
+    void addNullRows(size_t count) {
+        size_t rowCount = getRowCount();
+        for (size_t i = 0; i < count; i++) {
+            if ((rowCount + i) % ROW_GROUP_SIZE == 0) openRowGroup((rowCount + i) / ROW_GROUP_SIZE);
+        }
+        for (auto& pair : columns) {
+            for (size_t i = 0; i < count; i++) {
+                pair.second.addNull();
+            }
+        }
+    }
+    
+    bool hasTypedColumns() const {
+        for (const auto& pair : columns) {
+            if (pair.second.getType() != TYPE_TEXT) return true;
+        }
+        return false;
+    }
+    
+    void setColumnType(const std::string &colName, ColumnType type) {
+        auto it = columns.find(colName);
+        if (it == columns.end()) {
+            throw std::runtime_error("Column not found: " + colName);
+        }
+        it->second.setType(type);
+        if (colName == clusterKey) {
+            restoreCluster();
+        }
+    }
+    
+    size_t getRowGroupCount() const {
+        return (getRowCount() + ROW_GROUP_SIZE - 1) / ROW_GROUP_SIZE;
+    }
+    
+    // Opens the pages of a row group for every column together, so the
+    // mini-pages of one group are allocated side by side
+    void openRowGroup(size_t group) {
+        for (const auto& colName : columnOrder) {
+            Column& col = getColumn(colName);
+            while (col.pageCount() <= group) {
+                col.openPage();
+            }
+        }
+    }
+    
+    // Cursors over the given columns positioned at row of a row group
+    static std::vector<PageCursor> rowGroupCursors(const std::vector<const Column*> &cols,
+                                                   size_t group, size_t row) {
+        std::vector<PageCursor> cursors;
+        for (const Column* col : cols) {
+            cursors.push_back(group < col->pageCount() ? PageCursor(&col->page(group), col->getType(), row) : PageCursor());
+        }
+        return cursors;
+    }
+    
+    // Header lines of a table file holding the given columns
+    std::string fileHeader(const std::vector<std::string> &colNames,
+                           const std::vector<const Column*> &cols, size_t rowCount) const {
+        std::string header = "TABLE:" + name + "\n";
+        header += "COLUMNS:";
+        for (size_t i = 0; i < colNames.size(); i++) {
+            if (i > 0) header += ",";
+            header += colNames[i];
+        }
+        header += "\n";
+        bool typed = false;
+        for (const Column* col : cols) {
+            typed = typed || col->getType() != TYPE_TEXT;
+        }
+        if (typed) {
+            header += "TYPES:";
+            for (size_t i = 0; i < cols.size(); i++) {
+                if (i > 0) header += ",";
+                header += columnTypeName(cols[i]->getType());
+            }
+            header += "\n";
+        }
+        if (!clusterKey.empty() && std::find(colNames.begin(), colNames.end(), clusterKey) != colNames.end()) {
+            header += "CLUSTER:" + clusterKey + "\n";
+        }
+        header += "ROWS:";
+        appendUnsigned(header, rowCount);
+        header += "\n";
+        header += "DATA:\n";
+        return header;
+    }
+    
+    static void appendField(std::string &out, const Cell &cell) {
+        if (!cell.isNull() && cell.size() == 0) {
+            out += "\"\"";
+        } else {
+            out.append(cell.data(), cell.size());
+        }
+    }
+    
+    // Resolves the columns of a selection, in table order when it names none
+    std::vector<const Column*> selectedColumns(const Selection &sel, std::vector<std::string> &colNames) const {
+        colNames = sel.columns.empty() ? columnOrder : sel.columns;
+        std::vector<const Column*> cols;
+        for (const auto& colName : colNames) {
+            if (columns.find(colName) == columns.end()) {
+                throw std::runtime_error("Column not found: " + colName);
+            }
+            cols.push_back(&getColumn(colName));
+        }
+        return cols;
+    }
+    
+    size_t selectedRowCount(const Selection &sel) const {
+        return sel.allRows ? getRowCount() : sel.rows.size();
+    }
+    
+    // Calls fn with the selected rows in ascending batches of at most
+    // VIEW_BATCH_SIZE rows
+    template <typename Fn>
+    void forEachRowBatch(const Selection &sel, Fn fn) const {
+        std::vector<size_t> batch;
+        size_t total = selectedRowCount(sel);
+        for (size_t first = 0; first < total; first += VIEW_BATCH_SIZE) {
+            size_t count = std::min<size_t>(VIEW_BATCH_SIZE, total - first);
+            if (sel.allRows) {
+                batch.resize(count);
+                for (size_t i = 0; i < count; i++) batch[i] = first + i;
+            } else {
+                batch.assign(sel.rows.begin() + first, sel.rows.begin() + first + count);
+            }
+            fn(batch);
+        }
+    }
+    
+    // Gathers the cells of every column at rows; cells[j] holds column j
+    static void gatherBatch(const std::vector<const Column*> &cols, const std::vector<size_t> &rows,
+                            std::vector<std::vector<Cell>> &cells) {
+        cells.resize(cols.size());
+        for (size_t j = 0; j < cols.size(); j++) {
+            cells[j].clear();
+            cols[j]->gather(rows, cells[j]);
+        }
+    }
+    
+    // Up to FILTER_SAMPLE_SIZE rows of rowList, or of the whole table when
+    // all is set: one from each of as many equal strides, at a hashed
+    // offset so periodic data does not alias with the stride
+    std::vector<size_t> sampleRows(bool all, const std::vector<size_t> &rowList) const {
+        size_t count = all ? getRowCount() : rowList.size();
+        size_t stride = std::max<size_t>(1, count / FILTER_SAMPLE_SIZE);
+        std::vector<size_t> sample;
+        for (size_t first = 0; first + stride <= count && sample.size() < FILTER_SAMPLE_SIZE; first += stride) {
+            size_t i = first + mix64(first) % stride;
+            sample.push_back(all ? i : rowList[i]);
+        }
+        return sample;
+    }
+    
+    // Relative per-row cost: typed values compare as integers or doubles,
+    // text compares bytes and LIKE may scan the whole value
+    static double predicateCost(const Column &col, CompareOp op) {
+        if (op == OP_LIKE) return 4;
+        return col.getType() == TYPE_TEXT ? 2 : 1;
+    }
+    
+    // Formats row groups on worker threads in bounded waves and writes the buffers in order;
+    // with an index interval a row index sidecar is written too
+    void saveToFile(const std::string &filename, size_t indexInterval = 0) const {
+        FileWriter file(filename);
+        size_t rowCount = getRowCount();
+        std::vector<const Column*> cols;
+        for (const auto& colName : columnOrder) {
+            cols.push_back(&getColumn(colName));
+        }
+        std::string header = fileHeader(columnOrder, cols, rowCount);
+        file.write(header);
+        uint64_t written = header.size();
+        std::vector<uint64_t> offsets;
+        
+        // One chunk per row group, so each worker stays within its pages
+        size_t chunkCount = getRowGroupCount();
+        size_t wave = workerCount(chunkCount) * 2;
+        std::vector<std::string> buffers(wave);
+        std::vector<std::vector<uint64_t>> marks(wave);
+        for (size_t first = 0; first < chunkCount; first += wave) {
+            size_t count = std::min(wave, chunkCount - first);
+            parallelFor(count, [&](size_t k) {
+                std::string &out = buffers[k];
+                out.clear();
+                marks[k].clear();
+                size_t group = first + k;
+                size_t rows = std::min<size_t>(ROW_GROUP_SIZE, rowCount - group * ROW_GROUP_SIZE);
+                std::vector<PageCursor> cursors = rowGroupCursors(cols, group, 0);
+                for (size_t i = 0; i < rows; i++) {
+                    if (indexInterval && (group * ROW_GROUP_SIZE + i) % indexInterval == 0) {
+                        marks[k].push_back(out.size());
+                    }
+                    for (size_t j = 0; j < cursors.size(); j++) {
+                        if (j > 0) out += ',';
+                        appendField(out, cursors[j].next());
+                    }
+                    out += '\n';
+                }
+            });
+            for (size_t k = 0; k < count; k++) {
+                for (uint64_t mark : marks[k]) offsets.push_back(written + mark);
+                written += buffers[k].size();
+                file.write(buffers[k]);
+            }
+        }
+        file.finish();
+        writeRowIndex(filename, indexInterval, rowCount, written, offsets);
+    }
+    
+    // Writes the row index sidecar of filename, or removes a stale one when
+    // interval is 0
+    static void writeRowIndex(const std::string &filename, size_t interval, size_t rowCount,
+                              uint64_t fileSize, const std::vector<uint64_t> &offsets) {
+        std::string indexFilename = filename + ".idx";
+        if (interval == 0) {
+            std::remove(indexFilename.c_str());
+            return;
+        }
+        auto encode = [&](ImageWriter &writer) {
+            writer.bytes(ROW_INDEX_MAGIC, 8);
+            writer.u64(interval);
+            writer.u64(rowCount);
+            writer.u64(fileSize);
+            writer.bytes(offsets.data(), offsets.size() * sizeof(uint64_t));
+        };
+        ImageWriter sizer(nullptr);
+        encode(sizer);
+        writeFileWith(indexFilename, sizer.size(), [&](char* out) {
+            ImageWriter writer(out);
+            encode(writer);
+        });
+    }
+    
+    // Whether a predicate can be answered by binary search on the cluster key
+    bool usesClusterKey(const Predicate &p) const {
+        return !clusterKey.empty() && p.column == clusterKey && p.op != OP_NE && p.op != OP_LIKE;
+    }
+    
+    // Rows matching a predicate on the cluster key, among candidates when
+    // given: a binary-searched range of the sorted rows plus the matches in
+    // the tail
+    std::vector<size_t> clusterSelect(const Predicate &p, const std::vector<size_t>* candidates) const {
+        const Column &key = getColumn(clusterKey);
+        std::pair<size_t, size_t> range = key.sortedRange(p.op, p.value, sortedRows);
+        std::vector<size_t> rows, tail;
+        if (candidates) {
+            rows.assign(std::lower_bound(candidates->begin(), candidates->end(), range.first),
+                        std::lower_bound(candidates->begin(), candidates->end(), range.second));
+            tail.assign(std::lower_bound(candidates->begin(), candidates->end(), sortedRows), candidates->end());
+        } else {
+            for (size_t row = range.first; row < range.second; row++) rows.push_back(row);
+            for (size_t row = sortedRows; row < getRowCount(); row++) tail.push_back(row);
+        }
+        key.refine(p.op, p.value, tail, rows);
+        return rows;
+    }
+    
+    // Returns the rows (of candidates, or all rows when null) matching every predicate, running
+    // next the one with the lowest cost / (1 - selectivity) as estimated on a sample of the
+    // survivors; predicates is left in evaluation order with its estimates filled in
+    std::vector<size_t> filterRows(std::vector<Predicate> &predicates, const std::vector<size_t>* candidates) const {
+        for (const auto& p : predicates) {
+            if (columns.find(p.column) == columns.end()) {
+                throw std::runtime_error("Column not found: " + p.column);
+            }
+        }
+        bool all = candidates == nullptr;
+        std::vector<size_t> rows;
+        if (!all) rows = *candidates;
+        auto rank = [](const Predicate &p) {
+            return p.selectivity >= 1 ? std::numeric_limits<double>::infinity() : p.cost / (1 - p.selectivity);
+        };
+        for (size_t step = 0; step < predicates.size(); step++) {
+            std::vector<size_t> sample = sampleRows(all, rows);
+            for (size_t k = step; k < predicates.size(); k++) {
+                Predicate &p = predicates[k];
+                const Column &col = getColumn(p.column);
+                std::vector<size_t> hits;
+                col.refine(p.op, p.value, sample, hits);
+                p.selectivity = sample.empty() ? 0 : static_cast<double>(hits.size()) / sample.size();
+                p.cost = usesClusterKey(p) ? 0 : predicateCost(col, p.op);
+            }
+            std::stable_sort(predicates.begin() + step, predicates.end(),
+                             [&](const Predicate &a, const Predicate &b) { return rank(a) < rank(b); });
+            Predicate &p = predicates[step];
+            std::vector<size_t> next;
+            if (usesClusterKey(p)) next = clusterSelect(p, all ? nullptr : &rows);
+            else if (all) getColumn(p.column).select(p.op, p.value, next);
+            else getColumn(p.column).refine(p.op, p.value, rows, next);
+            rows.swap(next);
+            all = false;
+            p.evaluated = true;
+            p.matched = rows.size();
+            if (rows.empty()) break;
+        }
+        if (all) {
+            rows.resize(getRowCount());
+            for (size_t i = 0; i < rows.size(); i++) rows[i] = i;
+        }
+        return rows;
+    }
+    
+    // Adds colName as a number column computed by a window function and
+    // returns the number of partitions. Rows are partitioned once by hashing
+    // the partition column, and the partitions are computed in parallel.
+    size_t addWindowColumn(const std::string &colName, const WindowSpec &spec) {
+        if (columns.count(colName)) {
+            throw std::runtime_error("Column already exists: " + colName);
+        }
+        for (const std::string* used : {&spec.source, &spec.partition, &spec.order}) {
+            if (!used->empty() && !columns.count(*used)) {
+                throw std::runtime_error("Column not found: " + *used);
+            }
+        }
+        const Column* source = spec.source.empty() ? nullptr : &getColumn(spec.source);
+        if (source && source->getType() != TYPE_NUMBER) {
+            throw std::runtime_error("Window input needs a number column: " + spec.source + " (set its type with -t)");
+        }
+        if (spec.function == WINDOW_RANK && spec.order.empty()) {
+            throw std::runtime_error("rank needs an order column");
+        }
+        const Column* order = spec.order.empty() ? nullptr : &getColumn(spec.order);
+        size_t rowCount = getRowCount();
+        
+        // The rows of each partition lie in starts[p]..starts[p + 1] of
+        // partitioned, in table order until computeWindow sorts them
+        std::vector<size_t> starts(1, 0), partitioned(rowCount);
+        if (spec.partition.empty()) {
+            starts.push_back(rowCount);
+            for (size_t row = 0; row < rowCount; row++) partitioned[row] = row;
+        } else {
+            const Column &key = getColumn(spec.partition);
+            std::vector<uint64_t> hashes;
+            key.hash(hashes);
+            GroupTable groups;
+            std::vector<size_t> partitionOf(rowCount);
+            for (size_t row = 0; row < rowCount; row++) {
+                partitionOf[row] = groups.insert(hashes[row], row, [&](size_t a, size_t b) { return key.sameKey(a, b); });
+            }
+            starts.assign(groups.size() + 1, 0);
+            for (size_t row = 0; row < rowCount; row++) starts[partitionOf[row] + 1]++;
+            for (size_t p = 0; p < groups.size(); p++) starts[p + 1] += starts[p];
+            std::vector<size_t> next(starts.begin(), starts.end() - 1);
+            for (size_t row = 0; row < rowCount; row++) partitioned[next[partitionOf[row]]++] = row;
+        }
+        
+        // Workers take runs of whole partitions of at least VIEW_BATCH_SIZE rows
+        size_t partitions = starts.size() - 1;
+        std::vector<size_t> runs(1, 0);
+        for (size_t p = 0; p < partitions; p++) {
+            if (starts[p + 1] - starts[runs.back()] >= VIEW_BATCH_SIZE) runs.push_back(p + 1);
+        }
+        if (runs.back() != partitions) runs.push_back(partitions);
+        std::vector<double> values(rowCount);
+        std::vector<uint8_t> valid(rowCount), ties(rowCount);
+        parallelFor(runs.size() - 1, [&](size_t r) {
+            for (size_t p = runs[r]; p < runs[r + 1]; p++) {
+                computeWindow(spec, order, source, partitioned, ties, starts[p], starts[p + 1], values, valid);
+            }
+        });
+        
+        Column result(colName, arena);
+        result.setType(TYPE_NUMBER);
+        for (size_t row = 0; row < rowCount; row++) {
+            if (valid[row]) result.addStored(StringRef::fromNumber(values[row]));
+            else result.addNull();
+        }
+        columns.insert(std::make_pair(colName, std::move(result)));
+        columnOrder.push_back(colName);
+        return partitions;
+    }
+    
+    // Builds the crosstab of spec as a new table. Each row group is
+    // aggregated into its own hash table of (row key, column key) cells in
+    // parallel, the partials are merged, and the distinct keys of both
+    // sides are sorted to lay out the result.
+    Table pivot(const std::string &pivotName, const PivotSpec &spec) const {
+        for (const std::string* used : {&spec.rows, &spec.cols, &spec.value}) {
+            if (!used->empty() && !columns.count(*used)) {
+                throw std::runtime_error("Column not found: " + *used);
+            }
+        }
+        const Column &rowKey = getColumn(spec.rows);
+        const Column &colKey = getColumn(spec.cols);
+        const Column* value = spec.value.empty() ? nullptr : &getColumn(spec.value);
+        if (!value && spec.function != "count") {
+            throw std::runtime_error(spec.function + " needs a value column");
+        }
+        if (value && (spec.function == "sum" || spec.function == "avg") && value->getType() != TYPE_NUMBER) {
+            throw std::runtime_error(spec.function + " needs a number column: " + spec.value + " (set its type with -t)");
+        }
+        std::vector<uint64_t> rowHashes, colHashes;
+        rowKey.hash(rowHashes);
+        colKey.hash(colHashes);
+        auto cellHash = [&](size_t row) { return mix64(rowHashes[row] ^ mix64(colHashes[row])); };
+        auto sameCell = [&](size_t a, size_t b) { return rowKey.sameKey(a, b) && colKey.sameKey(a, b); };
+        auto fold = [&](size_t row, Aggregate &agg) {
+            if (value) value->accumulate(row, agg);
+            else agg.count++;
+        };
+        auto merge = [&](Aggregate &agg, const Aggregate &partial) {
+            if (value) value->combine(agg, partial);
+            else agg.count += partial.count;
+        };
+        
+        struct Partial {
+            GroupTable cells;
+            std::vector<Aggregate> states;
+        };
+        size_t rowCount = getRowCount();
+        std::vector<Partial> partials((rowCount + ROW_GROUP_SIZE - 1) / ROW_GROUP_SIZE);
+        parallelFor(partials.size(), [&](size_t group) {
+            Partial &partial = partials[group];
+            size_t end = std::min(rowCount, (group + 1) * ROW_GROUP_SIZE);
+            for (size_t row = group * ROW_GROUP_SIZE; row < end; row++) {
+                size_t cell = partial.cells.insert(cellHash(row), row, sameCell);
+                if (cell == partial.states.size()) partial.states.emplace_back();
+                fold(row, partial.states[cell]);
+            }
+        });
+        GroupTable cells;
+        std::vector<Aggregate> states;
+        for (const Partial &partial : partials) {
+            for (size_t c = 0; c < partial.cells.size(); c++) {
+                size_t first = partial.cells.first(c);
+                size_t cell = cells.insert(cellHash(first), first, sameCell);
+                if (cell == states.size()) states.emplace_back();
+                merge(states[cell], partial.states[c]);
+            }
+        }
+        
+        // Number the distinct keys of each side, then renumber them in
+        // sorted order; looking a sorted key up again yields its group
+        auto layout = [&](const Column &key, const std::vector<uint64_t> &hashes, std::vector<size_t> &cellPosition) {
+            GroupTable keys;
+            std::vector<size_t> cellKey(cells.size());
+            for (size_t cell = 0; cell < cells.size(); cell++) {
+                size_t first = cells.first(cell);
+                cellKey[cell] = keys.insert(hashes[first], first, [&](size_t a, size_t b) { return key.sameKey(a, b); });
+            }
+            std::vector<size_t> sorted(keys.size());
+            std::vector<uint8_t> ties(keys.size());
+            for (size_t k = 0; k < keys.size(); k++) sorted[k] = keys.first(k);
+            key.sortRows(sorted.begin(), sorted.end(), false, ties.begin());
+            std::vector<size_t> position(keys.size());
+            for (size_t i = 0; i < sorted.size(); i++) {
+                position[keys.insert(hashes[sorted[i]], sorted[i], [&](size_t a, size_t b) { return key.sameKey(a, b); })] = i;
+            }
+            cellPosition.resize(cells.size());
+            for (size_t cell = 0; cell < cells.size(); cell++) cellPosition[cell] = position[cellKey[cell]];
+            return sorted;
+        };
+        std::vector<size_t> cellRow, cellCol;
+        std::vector<size_t> rowKeys = layout(rowKey, rowHashes, cellRow);
+        std::vector<size_t> colKeys = layout(colKey, colHashes, cellCol);
+        if (colKeys.size() > PIVOT_MAX_COLUMNS) {
+            throw std::runtime_error("Too many pivot columns: " + spec.cols + " has " + std::to_string(colKeys.size()) +
+                                     " distinct values (at most " + std::to_string(PIVOT_MAX_COLUMNS) + ")");
+        }
+        
+        // Columns are named by their key value; NULL and clashing names
+        // get a placeholder or a suffix
+        Table result(pivotName);
+        result.addColumn(spec.rows);
+        result.getColumn(spec.rows).appendRows(rowKey, rowKeys, 0, rowKeys.size());
+        std::vector<std::string> names;
+        for (size_t c = 0; c < colKeys.size(); c++) {
+            Cell label = colKey[colKeys[c]];
+            std::string base = label.isNull() ? "(null)" : label.size() == 0 ? "\"\"" : label.getValue();
+            std::string colName = base;
+            for (int n = 2; result.columns.count(colName); n++) colName = base + "_" + std::to_string(n);
+            result.addColumn(colName);
+            names.push_back(colName);
+        }
+        // Walk the cells in (column, row) order, so scratch stays
+        // proportional to the cells present rather than the whole grid
+        std::vector<size_t> order(cells.size());
+        for (size_t cell = 0; cell < order.size(); cell++) order[cell] = cell;
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            return cellCol[a] != cellCol[b] ? cellCol[a] < cellCol[b] : cellRow[a] < cellRow[b];
+        });
+        size_t next = 0;
+        for (size_t c = 0; c < colKeys.size(); c++) {
+            Column &target = result.getColumn(names[c]);
+            target.setType(aggregateType(spec.function, value));
+            for (size_t r = 0; r < rowKeys.size(); r++) {
+                bool present = next < order.size() && cellCol[order[next]] == c && cellRow[order[next]] == r;
+                appendAggregate(target, spec.function, present ? &states[order[next++]] : nullptr);
+            }
+        }
+        return result;
+    }
+    
+    // Aggregates rows per time bucket of timeCol in one pass; with fill, empty buckets between
+    // the first and last appear too, and skipped receives the number of rows with a NULL time
+    Table resample(const std::string &resampleName, const std::string &timeCol, TimeUnit unit, int64_t step,
+                   const std::vector<AggregateSpec> &aggs, bool fill, size_t &skipped) const {
+        if (!columns.count(timeCol)) throw std::runtime_error("Column not found: " + timeCol);
+        const Column &time = getColumn(timeCol);
+        if (time.getType() != TYPE_DATE) throw std::runtime_error("Column is not a date column: " + timeCol);
+        std::vector<const Column*> inputs;
+        for (const auto& agg : aggs) {
+            if (agg.column.empty()) {
+                if (agg.function != "count") throw std::runtime_error(agg.function + " needs a column");
+                inputs.push_back(nullptr);
+                continue;
+            }
+            if (!columns.count(agg.column)) throw std::runtime_error("Column not found: " + agg.column);
+            inputs.push_back(&getColumn(agg.column));
+            if ((agg.function == "sum" || agg.function == "avg") && inputs.back()->getType() != TYPE_NUMBER) {
+                throw std::runtime_error(agg.function + " needs a number column: " + agg.column + " (set its type with -t)");
+            }
+        }
+        Table result(resampleName);
+        result.addColumn(timeCol);
+        Column &starts = result.getColumn(timeCol);
+        starts.setType(TYPE_DATE);
+        std::vector<Column*> targets;
+        for (size_t a = 0; a < aggs.size(); a++) {
+            std::string base = aggs[a].label(), colName = base;
+            for (int n = 2; result.columns.count(colName); n++) colName = base + "_" + std::to_string(n);
+            result.addColumn(colName);
+            targets.push_back(&result.getColumn(colName));
+            targets.back()->setType(aggregateType(aggs[a].function, inputs[a]));
+        }
+        skipped = time.nullCount();
+        Aggregate range = time.aggregate();
+        if (range.count == 0) return result;
+        
+        // The minimum and maximum give the first and last bucket. A span no
+        // larger than the data is indexed directly, a wider one through a map.
+        int64_t low = floorDiv(timeBucket(range.min.integer(), unit), step);
+        int64_t high = floorDiv(timeBucket(range.max.integer(), unit), step);
+        uint64_t span = static_cast<uint64_t>(high - low) + 1;
+        if (fill && span > RESAMPLE_MAX_BUCKETS) {
+            throw std::runtime_error("Too many buckets to fill: " + std::to_string(span) +
+                                     " (at most " + std::to_string(RESAMPLE_MAX_BUCKETS) + ")");
+        }
+        bool dense = span <= 2 * static_cast<uint64_t>(range.count) + 1024;
+        size_t width = aggs.size();
+        std::vector<Aggregate> states;
+        std::vector<uint8_t> seen;
+        std::unordered_map<int64_t, size_t> sparse;
+        if (dense) {
+            states.resize(span * width);
+            seen.resize(span);
+        }
+        // Event logs are mostly in time order, so the previous row's bucket
+        // [runFrom, runTo) usually holds the next row too
+        int64_t bucket = 0, runFrom = 1, runTo = 0;
+        size_t rowCount = time.size();
+        for (size_t row = 0; row < rowCount; row++) {
+            const StringRef* stamp = time.valueAt(row);
+            if (!stamp) continue;
+            int64_t t = stamp->integer();
+            if (t < runFrom || t >= runTo) {
+                bucket = floorDiv(timeBucket(t, unit), step);
+                runFrom = bucketStart(bucket * step, unit);
+                runTo = bucketStart((bucket + 1) * step, unit);
+            }
+            size_t index;
+            if (dense) {
+                index = static_cast<size_t>(bucket - low);
+                seen[index] = 1;
+            } else {
+                auto inserted = sparse.emplace(bucket, sparse.size());
+                if (inserted.second) states.resize(states.size() + width);
+                index = inserted.first->second;
+            }
+            Aggregate* state = &states[index * width];
+            for (size_t a = 0; a < width; a++) {
+                if (inputs[a]) inputs[a]->accumulate(row, state[a]);
+                else state[a].count++;
+            }
+        }
+        
+        std::vector<int64_t> buckets;
+        if (fill || dense) {
+            for (int64_t bucket = low; bucket <= high; bucket++) {
+                if (fill || seen[bucket - low]) buckets.push_back(bucket);
+            }
+        } else {
+            for (const auto& pair : sparse) buckets.push_back(pair.first);
+            std::sort(buckets.begin(), buckets.end());
+        }
+        Aggregate empty;
+        for (int64_t bucket : buckets) {
+            starts.addStored(StringRef::fromInteger(bucketStart(bucket * step, unit)));
+            const Aggregate* state = &empty;
+            if (dense && seen[bucket - low]) {
+                state = &states[static_cast<size_t>(bucket - low) * width];
+            } else if (!dense) {
+                auto it = sparse.find(bucket);
+                if (it != sparse.end()) state = &states[it->second * width];
+            }
+            for (size_t a = 0; a < width; a++) {
+                appendAggregate(*targets[a], aggs[a].function, state == &empty ? &empty : &state[a]);
+            }
+        }
+        return result;
+    }
+    
+    // Joins two tables clustered on keys of the same type by walking both in
+    // key order. The result has every column of left and the other columns
+    // of right, prefixed with right's name where they clash, and is
+    // clustered on left's key. Both tails must have been merged.
+    static Table mergeJoin(const Table &left, const Table &right, const std::string &joinName) {
+        for (const Table* table : {&left, &right}) {
+            if (table->clusterKey.empty()) {
+                throw std::runtime_error("Table is not clustered: " + table->name);
+            }
+            if (table->clusterTailRows() > 0) {
+                throw std::runtime_error("Table has unmerged rows: " + table->name);
+            }
+        }
+        std::vector<size_t> leftRows, rightRows;
+        Column::mergeJoin(left.getColumn(left.clusterKey), right.getColumn(right.clusterKey), leftRows, rightRows);
+        
+        Table result(joinName);
+        std::vector<const Column*> sources;
+        std::vector<const std::vector<size_t>*> orders;
+        for (const auto& colName : left.columnOrder) {
+            result.addColumn(colName);
+            sources.push_back(&left.getColumn(colName));
+            orders.push_back(&leftRows);
+        }
+        for (const auto& colName : right.columnOrder) {
+            if (colName == right.clusterKey) continue;
+            std::string resultName = result.columns.count(colName) ? right.name + "." + colName : colName;
+            result.addColumn(resultName);
+            sources.push_back(&right.getColumn(colName));
+            orders.push_back(&rightRows);
+        }
+        std::vector<Column*> targets;
+        for (const auto& colName : result.columnOrder) {
+            targets.push_back(&result.getColumn(colName));
+        }
+        appendInOrder(targets, sources, orders, leftRows.size());
+        result.clusterKey = left.clusterKey;
+        result.sortedRows = leftRows.size();
+        return result;
+    }
+    
+    // Writes only the selected rows and columns, gathering one batch at a
+    // time; the full table is written by the parallel path above
+    void saveToFile(const std::string &filename, const Selection &sel, size_t indexInterval = 0) const {
+        if (sel.isEverything()) {
+            saveToFile(filename, indexInterval);
+            return;
+        }
+        std::vector<std::string> colNames;
+        std::vector<const Column*> cols = selectedColumns(sel, colNames);
+        FileWriter file(filename);
+        std::string header = fileHeader(colNames, cols, selectedRowCount(sel));
+        file.write(header);
+        uint64_t written = header.size();
+        std::vector<uint64_t> offsets;
+        size_t rowNumber = 0;
+        std::vector<std::vector<Cell>> cells;
+        std::string out;
+        forEachRowBatch(sel, [&](const std::vector<size_t> &rows) {
+            gatherBatch(cols, rows, cells);
+            out.clear();
+            for (size_t i = 0; i < rows.size(); i++, rowNumber++) {
+                if (indexInterval && rowNumber % indexInterval == 0) {
+                    offsets.push_back(written + out.size());
+                }
+                for (size_t j = 0; j < cols.size(); j++) {
+                    if (j > 0) out += ',';
+                    appendField(out, cells[j][i]);
+                }
+                out += '\n';
+            }
+            written += out.size();
+            file.write(out);
+        });
+        file.finish();
+        writeRowIndex(filename, indexInterval, selectedRowCount(sel), written, offsets);
+    }
+    
+    // Reads the TABLE, COLUMNS, optional TYPES and CLUSTER, ROWS and DATA
+    // lines into an empty table; Source is a LineReader or BufferLineReader
+    template <typename Source>
+    static Table readHeader(Source &file, size_t &rowCount) {
+        std::string line;
+        
+        // Read table name
+        file.next(line);
+        if (line.substr(0, 6) != "TABLE:") {
+            throw std::runtime_error("Invalid file format: missing TABLE header");
+        }
+        std::string tableName = line.substr(6);
+        
+        // Read columns
+        file.next(line);
+        if (line.substr(0, 8) != "COLUMNS:") {
+            throw std::runtime_error("Invalid file format: missing COLUMNS header");
+        }
+        std::string columnsStr = line.substr(8);
+        std::vector<std::string> colNames = split(columnsStr, ',');
+        
+        Table table(tableName);
+        for (const auto& colName : colNames) {
+            table.addColumn(colName);
+        }
+        
+        // Read optional column types
+        file.next(line);
+        if (line.substr(0, 6) == "TYPES:") {
+            std::vector<std::string> typeNames = split(line.substr(6), ',');
+            if (typeNames.size() != table.columnOrder.size()) {
+                throw std::runtime_error("Invalid file format: TYPES does not match COLUMNS");
+            }
+            for (size_t j = 0; j < typeNames.size(); j++) {
+                ColumnType type;
+                if (!parseColumnType(typeNames[j], type)) {
+                    throw std::runtime_error("Invalid file format: unknown type " + typeNames[j]);
+                }
+                table.getColumn(table.columnOrder[j]).setType(type);
+            }
+            file.next(line);
+        }
+        
+        // Read optional cluster key
+        if (line.substr(0, 8) == "CLUSTER:") {
+            table.clusterKey = line.substr(8);
+            if (table.columns.find(table.clusterKey) == table.columns.end()) {
+                throw std::runtime_error("Invalid file format: unknown cluster key " + table.clusterKey);
+            }
+            file.next(line);
+        }
+        
+        // Read row count
+        if (line.substr(0, 5) != "ROWS:" || !parseUnsigned(line.substr(5), rowCount)) {
+            throw std::runtime_error("Invalid file format: missing ROWS header");
+        }
+        
+        // Skip DATA line
+        file.next(line);
+        return table;
+    }
+    
+    // Parses one data line of a saved file and appends it as a row; row is
+    // its number in the file, for error messages
+    void appendLine(const std::vector<Column*> &cols, const char* begin, const char* end,
+                    std::vector<std::string> &values, size_t row) {
+        splitFields(begin, end, ',', values);
+        size_t rowCount = getRowCount();
+        if (rowCount % ROW_GROUP_SIZE == 0) {
+            openRowGroup(rowCount / ROW_GROUP_SIZE);
+        }
+        
+        if (values.size() != cols.size()) {
+            throw std::runtime_error("incorrect syntax in row " + std::to_string(row));
+        }
+        
+        for (size_t j = 0; j < cols.size(); j++) {
+            if (values[j].empty()) {
+                cols[j]->addNull();
+            } else if (values[j] == "\"\"") {
+                cols[j]->addCell("", 0);
+            } else {
+                cols[j]->addCell(values[j]);
+            }
+        }
+    }
+    
+    std::vector<Column*> columnsInOrder() {
+        std::vector<Column*> cols;
+        for (const auto& colName : columnOrder) {
+            cols.push_back(&getColumn(colName));
+        }
+        return cols;
+    }
+    
+    // Reads count data rows from file and appends them; row is the number
+    // of the first one, for error messages
+    template <typename Source>
+    void readRows(Source &file, size_t row, size_t count) {
+        std::vector<Column*> cols = columnsInOrder();
+        std::vector<std::string> values;
+        for (size_t i = row; i < row + count; i++) {
+            const char* begin;
+            const char* end;
+            if (!file.next(begin, end)) {
+                throw std::runtime_error("incorrect syntax in row " + std::to_string(i));
+            }
+            appendLine(cols, begin, end, values, i);
+        }
+    }
+    
+    // Streams the data rows of file and appends only the rows numbered in
+    // chosen, which is ascending; the other lines are never split
+    template <typename Source>
+    void readChosenRows(Source &file, const std::vector<size_t> &chosen) {
+        std::vector<Column*> cols = columnsInOrder();
+        std::vector<std::string> values;
+        size_t next = 0;
+        for (size_t i = 0; next < chosen.size(); i++) {
+            const char* begin;
+            const char* end;
+            if (!file.next(begin, end)) {
+                throw std::runtime_error("incorrect syntax in row " + std::to_string(i));
+            }
+            if (i == chosen[next]) {
+                appendLine(cols, begin, end, values, i);
+                next++;
+            }
+        }
+    }
+    
+    static Table loadFromFile(const std::string &filename) {
+        LineReader file(filename);
+        size_t rowCount;
+        Table table = readHeader(file, rowCount);
+        table.readRows(file, 0, rowCount);
+        table.restoreCluster();
+        return table;
+    }
+    
+    // Reads up to count rows from row first (0-based) of a saved table
+    // through its row index sidecar. Only the header, one index entry and
+    // the rows from the preceding index mark on are read from the mapped
+    // files. totalRows receives the row count of the whole file.
+    static Table loadRowWindow(const std::string &filename, size_t first, size_t count, size_t &totalRows) {
+        MappedFile file(filename);
+        BufferLineReader lines(file.data(), file.data() + file.size());
+        Table table = readHeader(lines, totalRows);
+        if (!fileExists(filename + ".idx")) {
+            throw std::runtime_error("No row index for " + filename + " (save it with -sv <file> --index)");
+        }
+        MappedFile indexFile(filename + ".idx");
+        ImageReader index(indexFile.data(), indexFile.size());
+        if (std::memcmp(index.take(8), ROW_INDEX_MAGIC, 8) != 0) {
+            throw std::runtime_error("Invalid row index: " + filename + ".idx");
+        }
+        uint64_t interval = index.u64();
+        uint64_t indexedRows = index.u64();
+        uint64_t fileSize = index.u64();
+        if (interval == 0 || indexedRows != totalRows || fileSize != file.size()) {
+            throw std::runtime_error("Row index is out of date: " + filename + ".idx (save the table again)");
+        }
+        if (first >= totalRows) return table;
+        size_t mark = static_cast<size_t>(first / interval);
+        index.take(mark * sizeof(uint64_t));
+        uint64_t offset = index.u64();
+        if (offset > file.size()) {
+            throw std::runtime_error("Invalid row index: " + filename + ".idx");
+        }
+        BufferLineReader rows(file.data() + offset, file.data() + file.size());
+        const char* begin;
+        const char* end;
+        for (size_t row = mark * interval; row < first; row++) {
+            if (!rows.next(begin, end)) {
+                throw std::runtime_error("incorrect syntax in row " + std::to_string(row));
+            }
+        }
+        table.readRows(rows, first, std::min(count, totalRows - first));
+        table.restoreCluster();
+        return table;
+    }
+    
+    // A uniform random sample of the rows, without repeats and in table
+    // order, as a new table; a clustered table's sample stays clustered
+    Table sample(const std::string &sampleName, const SampleSize &size, uint64_t seed) const {
+        std::vector<size_t> chosen = sampleRowNumbers(getRowCount(), size.of(getRowCount()), seed);
+        Table result(sampleName);
+        std::vector<const Column*> sources;
+        for (const auto& colName : columnOrder) {
+            result.addColumn(colName);
+            sources.push_back(&getColumn(colName));
+        }
+        std::vector<Column*> targets = result.columnsInOrder();
+        appendInOrder(targets, sources, std::vector<const std::vector<size_t>*>(sources.size(), &chosen), chosen.size());
+        result.clusterKey = clusterKey;
+        result.restoreCluster();
+        return result;
+    }
+    
+    // Samples a saved table without loading it: the row numbers are drawn
+    // from the ROWS header up front, then one streaming pass over the file
+    // parses only those rows. totalRows receives the file's row count.
+    static Table sampleFile(const std::string &filename, const SampleSize &size, uint64_t seed, size_t &totalRows) {
+        LineReader file(filename);
+        Table table = readHeader(file, totalRows);
+        table.readChosenRows(file, sampleRowNumbers(totalRows, size.of(totalRows), seed));
+        table.restoreCluster();
+        return table;
+    }
+    
+    // Writes the binary image of this table to buffer (or only measures it
+    // when buffer is null) and returns its size in bytes
+    size_t writeImage(char* buffer) const {
+        ImageWriter writer(buffer);
+        size_t rowCount = getRowCount();
+        writer.bytes(IMAGE_MAGIC, 8);
+        writer.u32(static_cast<uint32_t>(name.size()));
+        writer.u32(static_cast<uint32_t>(columnOrder.size()));
+        writer.u64(rowCount);
+        writer.bytes(name.data(), name.size());
+        writer.align();
+        for (const auto& colName : columnOrder) {
+            writer.str(colName);
+        }
+        for (const auto& colName : columnOrder) {
+            const Column& col = getColumn(colName);
+            writer.u32(col.getType());
+            writer.u32(colName == clusterKey ? IMAGE_CLUSTER_KEY : 0);
+            writer.u64(col.size() - col.nullCount());
+            size_t words = 0;
+            for (size_t p = 0; p < col.pageCount(); p++) {
+                for (uint64_t word : col.page(p).validity) {
+                    writer.u64(word);
+                    words++;
+                }
+            }
+            for (; words < (rowCount + 63) / 64; words++) {
+                writer.u64(0);
+            }
+            if (col.getType() != TYPE_TEXT) {
+                for (size_t p = 0; p < col.pageCount(); p++) {
+                    for (const auto& ref : col.page(p).values) {
+                        writer.bytes(ref.inlined, 8);
+                    }
+                }
+                continue;
+            }
+            uint64_t pos = 0;
+            writer.u64(pos);
+            for (size_t p = 0; p < col.pageCount(); p++) {
+                for (const auto& ref : col.page(p).values) {
+                    pos += ref.length;
+                    writer.u64(pos);
+                }
+            }
+            for (size_t p = 0; p < col.pageCount(); p++) {
+                for (const auto& ref : col.page(p).values) {
+                    writer.bytes(ref.data(), ref.length);
+                }
+            }
+            writer.align();
+        }
+        return writer.size();
+    }
+    
+    // Rebuilds a table from an image without any text parsing. Cell headers
+    // are rebuilt, but text values too long to inline keep pointing into
+    // the buffer, which owner keeps alive for as long as the table's arena.
+    static Table fromImage(const char* buffer, size_t size, const std::shared_ptr<const void> &owner) {
+        ImageReader reader(buffer, size);
+        if (std::memcmp(reader.take(8), IMAGE_MAGIC, 8) != 0) {
+            throw std::runtime_error("Invalid image: bad magic");
+        }
+        uint32_t nameLen = reader.u32();
+        uint32_t columnCount = reader.u32();
+        uint64_t rowCount = reader.u64();
+        if (rowCount > static_cast<uint64_t>(size) * 8) {
+            throw std::runtime_error("Invalid image: bad row count");
+        }
+        Table table(std::string(reader.take(nameLen), nameLen));
+        table.arena->pin(owner);
+        reader.align();
+        
+        std::vector<std::string> colNames;
+        for (uint32_t j = 0; j < columnCount; j++) {
+            colNames.push_back(reader.str());
+            table.addColumn(colNames.back());
+        }
+        for (size_t group = 0; group * ROW_GROUP_SIZE < rowCount; group++) {
+            table.openRowGroup(group);
+        }
+        for (uint32_t j = 0; j < columnCount; j++) {
+            uint32_t type = reader.u32();
+            uint32_t flags = reader.u32();
+            uint64_t valueCount = reader.u64();
+            if (valueCount > rowCount || type > TYPE_DATE) {
+                throw std::runtime_error("Invalid image: bad header in column " + colNames[j]);
+            }
+            const char* validityBytes = reader.take((rowCount + 63) / 64 * sizeof(uint64_t));
+            Column& col = table.getColumn(colNames[j]);
+            if (flags & IMAGE_CLUSTER_KEY) {
+                table.clusterKey = colNames[j];
+            }
+            if (type != TYPE_TEXT) {
+                col.setType(static_cast<ColumnType>(type));
+                const char* payload = reader.take(valueCount * 8);
+                uint64_t value = 0;
+                for (uint64_t i = 0; i < rowCount; i++) {
+                    uint64_t word;
+                    std::memcpy(&word, validityBytes + (i / 64) * sizeof(uint64_t), sizeof(word));
+                    if (!((word >> (i % 64)) & 1)) {
+                        col.addNull();
+                        continue;
+                    }
+                    if (value == valueCount) {
+                        throw std::runtime_error("Invalid image: bad validity in column " + colNames[j]);
+                    }
+                    StringRef ref;
+                    std::memset(&ref, 0, sizeof(ref));
+                    ref.length = 8;
+                    std::memcpy(ref.inlined, payload + 8 * value++, 8);
+                    col.addStored(ref);
+                }
+                continue;
+            }
+            const char* offsetBytes = reader.take((valueCount + 1) * sizeof(uint64_t));
+            uint64_t blobSize;
+            std::memcpy(&blobSize, offsetBytes + valueCount * sizeof(uint64_t), sizeof(blobSize));
+            const char* blob = reader.take(blobSize);
+            reader.align();
+            
+            uint64_t value = 0;
+            uint64_t begin;
+            std::memcpy(&begin, offsetBytes, sizeof(begin));
+            for (uint64_t i = 0; i < rowCount; i++) {
+                uint64_t word;
+                std::memcpy(&word, validityBytes + (i / 64) * sizeof(uint64_t), sizeof(word));
+                if (!((word >> (i % 64)) & 1)) {
+                    col.addNull();
+                    continue;
+                }
+                uint64_t end;
+                if (value == valueCount) {
+                    throw std::runtime_error("Invalid image: bad validity in column " + colNames[j]);
+                }
+                std::memcpy(&end, offsetBytes + (++value) * sizeof(uint64_t), sizeof(end));
+                if (end < begin || end > blobSize) {
+                    throw std::runtime_error("Invalid image: bad offsets in column " + colNames[j]);
+                }
+                col.addBorrowed(blob + begin, end - begin);
+                begin = end;
+            }
+        }
+        table.restoreCluster();
+        return table;
+    }
+    
+    void displayASCII() const {
+        displayASCII(Selection());
+    }
+    
+    // Prints the selected rows, numbered by their position in the table
+    // plus firstRowNumber. Cells are gathered one batch at a time, once to
+    // size the columns and once to print them.
+    void displayASCII(const Selection &sel, size_t firstRowNumber = 1) const {
+        if (columns.empty()) {
+            std::cout << "Table is empty." << std::endl;
+            return;
+        }
+        std::vector<std::string> colNames;
+        std::vector<const Column*> cols = selectedColumns(sel, colNames);
+        // Calculate column widths
+        std::vector<size_t> colWidths;
+        for (const auto& colName : colNames) {
+            colWidths.push_back(colName.length());
+        }
+        std::vector<std::vector<Cell>> cells;
+        size_t lastRow = 0;
+        forEachRowBatch(sel, [&](const std::vector<size_t> &rows) {
+            gatherBatch(cols, rows, cells);
+            for (size_t j = 0; j < cols.size(); j++) {
+                for (const auto& cell : cells[j]) {
+                    colWidths[j] = std::max(colWidths[j], cell.size());
+                }
+            }
+            lastRow = rows.back() + firstRowNumber;
+        });
+        // Add extra width for line numbers
+        std::string lineNum;
+        appendUnsigned(lineNum, lastRow);
+        size_t lineNumWidth = lineNum.length();
+        // Print header
+        std::cout << "+" << std::string(lineNumWidth + 2, '-') << "+";
+        for (size_t width : colWidths) {
+            std::cout << std::string(width + 2, '-') << "+";
+        }
+        std::cout << std::endl;
+        std::cout << "| " << std::setw(lineNumWidth) << std::left << "#" << " |";
+        for (size_t j = 0; j < colNames.size(); j++) {
+            std::cout << " " << std::setw(colWidths[j]) << std::left << colNames[j] << " |";
+        }
+        std::cout << std::endl;
+        std::cout << "+" << std::string(lineNumWidth + 2, '-') << "+";
+        for (size_t width : colWidths) {
+            std::cout << std::string(width + 2, '-') << "+";
+        }
+        std::cout << std::endl;
+        // Print rows with line numbers
+        forEachRowBatch(sel, [&](const std::vector<size_t> &rows) {
+            gatherBatch(cols, rows, cells);
+            for (size_t i = 0; i < rows.size(); i++) {
+                lineNum.clear();
+                appendUnsigned(lineNum, rows[i] + firstRowNumber);
+                std::cout << "| " << lineNum << std::string(lineNumWidth - lineNum.size(), ' ') << " |";
+                for (size_t j = 0; j < cols.size(); j++) {
+                    const Cell &cell = cells[j][i];
+                    std::cout << " " << cell << std::string(colWidths[j] - cell.size(), ' ') << " |";
+                }
+                std::cout << "\n";
+            }
+        });
+        std::cout << "+" << std::string(lineNumWidth + 2, '-') << "+";
+        for (size_t width : colWidths) {
+            std::cout << std::string(width + 2, '-') << "+";
+        }
+        std::cout << std::endl;
+    }
+};
+
+// CatalogEntry describes a table file in the data directory, as read from
+// its header lines only
+struct CatalogEntry {
+    std::string name;
+    std::string path;
+    std::vector<std::string> columns;
+    std::vector<ColumnType> types;
+    size_t rowCount = 0;
+    uint64_t bytes = 0;
+    std::time_t modified = 0;
+    bool indexed = false;
+};
+
+// Yields lines from an input stream, for reading just a file's header
+class StreamLineReader {
+private:
+    std::istream &in;
+public:
+    explicit StreamLineReader(std::istream &stream) : in(stream) {}
+    
+    bool next(std::string &line) {
+        if (!std::getline(in, line)) return false;
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        return true;
+    }
+};
+
+// SQL front end of the sql command: a SELECT subset with joins, WHERE ... AND, GROUP BY,
+// ORDER BY and LIMIT (see README) is parsed into an SqlQuery for SqlEngine
+struct SqlToken {
+    enum Kind { WORD, NUMBER, STRING, SYMBOL, END };
+    Kind kind;
+    std::string text;
+    bool quoted;
+};
+
+inline std::vector<SqlToken> tokenizeSql(const std::string &text) {
+    std::vector<SqlToken> tokens;
+    size_t i = 0;
+    while (i < text.size()) {
+        unsigned char c = static_cast<unsigned char>(text[i]);
+        size_t start = i;
+        if (std::isspace(c)) {
+            i++;
+        } else if (std::isalpha(c) || c == '_') {
+            while (i < text.size() && (std::isalnum(static_cast<unsigned char>(text[i])) || text[i] == '_')) i++;
+            tokens.push_back({SqlToken::WORD, text.substr(start, i - start), false});
+        } else if (std::isdigit(c)) {
+            while (i < text.size() && (std::isalnum(static_cast<unsigned char>(text[i])) || text[i] == '.')) i++;
+            tokens.push_back({SqlToken::NUMBER, text.substr(start, i - start), false});
+        } else if (c == '\'' || c == '"') {
+            // 'text' is a string and "name" a quoted identifier; a doubled
+            // quote stands for itself
+            std::string value;
+            for (i++; ; i++) {
+                if (i >= text.size()) {
+                    throw std::runtime_error("SQL syntax error: unterminated quote");
+                }
+                if (text[i] == static_cast<char>(c)) {
+                    if (i + 1 < text.size() && text[i + 1] == static_cast<char>(c)) {
+                        i++;
+                    } else {
+                        i++;
+                        break;
+                    }
+                }
+                value += text[i];
+            }
+            tokens.push_back({c == '\'' ? SqlToken::STRING : SqlToken::WORD, value, true});
+        } else {
+            std::string two = text.substr(i, 2);
+            if (two == "<=" || two == ">=" || two == "!=" || two == "<>") {
+                i += 2;
+            } else if (std::strchr(",()*.=<>;-", c)) {
+                i++;
+            } else {
+                throw std::runtime_error("SQL syntax error: unexpected character '" + std::string(1, c) + "'");
+            }
+            tokens.push_back({SqlToken::SYMBOL, text.substr(start, i - start), false});
+        }
+    }
+    tokens.push_back({SqlToken::END, "", false});
+    return tokens;
+}
+
+struct SqlColumnRef {
+    std::string table;
+    std::string column;
+
+    std::string text() const { return table.empty() ? column : table + "." + column; }
+};
+
+struct SqlSelectItem {
+    bool star = false;
+    std::string function; // lower case aggregate name; empty for a column
+    bool countAll = false;
+    SqlColumnRef column;
+    std::string alias;
+
+    std::string text() const {
+        if (function.empty()) return column.text();
+        return function + "(" + (countAll ? std::string("*") : column.text()) + ")";
+    }
+};
+
+struct SqlCondition {
+    SqlColumnRef left;
+    std::string opText;
+    CompareOp op = OP_EQ;
+    bool joinsColumns = false;
+    SqlColumnRef right;
+    std::string value;
+};
+
+struct SqlOrderItem {
+    SqlColumnRef column;
+    size_t ordinal = 0; // 1-based position in the select list, 0 for a column
+    bool descending = false;
+};
+
+struct SqlQuery {
+    bool explain = false;
+    std::vector<SqlSelectItem> items;
+    std::vector<std::pair<std::string, std::string>> tables; // name, alias
+    std::vector<SqlCondition> conditions;
+    std::vector<SqlColumnRef> groupBy;
+    std::vector<SqlOrderItem> orderBy;
+    bool hasLimit = false;
+    size_t limit = 0;
+};
+
+// Recursive-descent parser for the grammar above; keywords are case
+// insensitive and must be quoted to be used as names
+class SqlParser {
+private:
+    std::vector<SqlToken> tokens;
+    size_t pos;
+
+    const SqlToken& peek() const { return tokens[pos]; }
+
+    static bool isReserved(const std::string &word) {
+        static const char* const reserved[] = {
+            "select", "from", "where", "group", "by", "order", "limit", "join", "inner", "on",
+            "and", "as", "asc", "desc", "explain", "like"
+        };
+        std::string lower = toLower(word);
+        for (const char* keyword : reserved) {
+            if (lower == keyword) return true;
+        }
+        return false;
+    }
+
+    bool atKeyword(const char* keyword) const {
+        return peek().kind == SqlToken::WORD && !peek().quoted && toLower(peek().text) == keyword;
+    }
+
+    bool accept(const char* keyword) {
+        if (!atKeyword(keyword)) return false;
+        pos++;
+        return true;
+    }
+
+    bool acceptSymbol(const char* symbol) {
+        if (peek().kind != SqlToken::SYMBOL || peek().text != symbol) return false;
+        pos++;
+        return true;
+    }
+
+    [[noreturn]] void fail(const std::string &expected) const {
+        std::string near = peek().kind == SqlToken::END ? "end of query" : "'" + peek().text + "'";
+        throw std::runtime_error("SQL syntax error: expected " + expected + " near " + near);
+    }
+
+    void expect(const char* keyword) {
+        if (!accept(keyword)) fail(toUpperKeyword(keyword));
+    }
+
+    static std::string toUpperKeyword(const char* keyword) {
+        std::string upper(keyword);
+        for (auto& c : upper) c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+        return upper;
+    }
+
+    std::string name(const char* what) {
+        const SqlToken &token = peek();
+        if (token.kind != SqlToken::WORD || (!token.quoted && isReserved(token.text))) fail(what);
+        pos++;
+        return token.text;
+    }
+
+    bool atName() const {
+        return peek().kind == SqlToken::WORD && (peek().quoted || !isReserved(peek().text));
+    }
+
+    SqlColumnRef columnRef() {
+        SqlColumnRef ref;
+        ref.column = name("a column name");
+        if (acceptSymbol(".")) {
+            ref.table = ref.column;
+            ref.column = name("a column name");
+        }
+        return ref;
+    }
+
+    std::string literal() {
+        bool negative = acceptSymbol("-");
+        const SqlToken &token = peek();
+        if (token.kind == SqlToken::NUMBER || (token.kind == SqlToken::STRING && !negative)) {
+            pos++;
+            return negative ? "-" + token.text : token.text;
+        }
+        fail("a number or a quoted string");
+    }
+
+    SqlCondition condition() {
+        SqlCondition cond;
+        cond.left = columnRef();
+        if (atKeyword("like")) {
+            cond.opText = toLower(peek().text);
+            pos++;
+        } else if (peek().kind == SqlToken::SYMBOL && peek().text != "," && peek().text != ")") {
+            cond.opText = peek().text == "<>" ? "!=" : peek().text;
+            pos++;
+        }
+        if (cond.opText.empty() || !parseCompareOp(cond.opText, cond.op)) {
+            fail("a comparison operator");
+        }
+        if (atName()) {
+            cond.joinsColumns = true;
+            cond.right = columnRef();
+        } else {
+            cond.value = literal();
+        }
+        return cond;
+    }
+
+    SqlSelectItem selectItem() {
+        SqlSelectItem item;
+        if (acceptSymbol("*")) {
+            item.star = true;
+            return item;
+        }
+        static const char* const functions[] = {"count", "sum", "avg", "min", "max"};
+        for (const char* function : functions) {
+            if (atKeyword(function) && tokens[pos + 1].kind == SqlToken::SYMBOL && tokens[pos + 1].text == "(") {
+                pos += 2;
+                item.function = function;
+                if (item.function == "count" && acceptSymbol("*")) {
+                    item.countAll = true;
+                } else {
+                    item.column = columnRef();
+                }
+                if (!acceptSymbol(")")) fail("')'");
+                break;
+            }
+        }
+        if (item.function.empty()) {
+            item.column = columnRef();
+        }
+        if (accept("as") || atName()) {
+            item.alias = name("a column alias");
+        }
+        return item;
+    }
+
+    void tableRef(SqlQuery &query) {
+        std::string table = name("a table name");
+        std::string alias;
+        if (accept("as") || atName()) {
+            alias = name("a table alias");
+        }
+        query.tables.push_back(std::make_pair(table, alias));
+    }
+
+public:
+    explicit SqlParser(const std::string &text) : tokens(tokenizeSql(text)), pos(0) {}
+
+    SqlQuery parse() {
+        SqlQuery query;
+        query.explain = accept("explain");
+        expect("select");
+        do {
+            query.items.push_back(selectItem());
+        } while (acceptSymbol(","));
+        expect("from");
+        tableRef(query);
+        while (true) {
+            if (acceptSymbol(",")) {
+                tableRef(query);
+            } else if (atKeyword("join") || atKeyword("inner")) {
+                if (accept("inner")) expect("join");
+                else pos++;
+                tableRef(query);
+                expect("on");
+                do {
+                    query.conditions.push_back(condition());
+                } while (accept("and"));
+            } else {
+                break;
+            }
+        }
+        if (accept("where")) {
+            do {
+                query.conditions.push_back(condition());
+            } while (accept("and"));
+        }
+        if (accept("group")) {
+            expect("by");
+            do {
+                query.groupBy.push_back(columnRef());
+            } while (acceptSymbol(","));
+        }
+        if (accept("order")) {
+            expect("by");
+            do {
+                SqlOrderItem item;
+                if (peek().kind == SqlToken::NUMBER) {
+                    if (!parseUnsigned(peek().text, item.ordinal) || item.ordinal == 0) fail("a column number");
+                    pos++;
+                } else {
+                    item.column = columnRef();
+                }
+                if (accept("desc")) item.descending = true;
+                else accept("asc");
+                query.orderBy.push_back(item);
+            } while (acceptSymbol(","));
+        }
+        if (accept("limit")) {
+            if (peek().kind != SqlToken::NUMBER || !parseUnsigned(peek().text, query.limit)) fail("a row count");
+            pos++;
+            query.hasLimit = true;
+        }
+        acceptSymbol(";");
+        if (peek().kind != SqlToken::END) fail("end of query");
+        return query;
+    }
+};
+
+// Plans and runs an SqlQuery: filters are pushed down to their tables, joins start from the
+// smallest filtered table, and the joined rows stream through projection or hash aggregation
+class SqlEngine {
+public:
+    typedef std::function<std::shared_ptr<Table>(const std::string&)> TableLookup;
+
+private:
+    struct Scan {
+        std::shared_ptr<Table> table;
+        std::string name; // alias, or the table name
+        std::vector<Predicate> filters;
+        std::vector<std::string> reads;
+        std::vector<size_t> rows;
+    };
+
+    struct Edge {
+        size_t left;
+        std::string leftColumn;
+        size_t right;
+        std::string rightColumn;
+        bool applied;
+    };
+
+    struct Bound {
+        size_t scan;
+        std::string column;
+    };
+
+    // Joined rows: rows[k][i] is the row of scan scans[k] in result row i
+    struct RowSet {
+        std::vector<size_t> scans;
+        std::vector<std::vector<size_t>> rows;
+
+        size_t size() const { return rows.empty() ? 0 : rows[0].size(); }
+        size_t position(size_t scan) const {
+            return static_cast<size_t>(std::find(scans.begin(), scans.end(), scan) - scans.begin());
+        }
+    };
+
+    struct Output {
+        std::string name;
+        std::string function;
+        bool countAll;
+        Bound source;
+        bool hidden;
+    };
+
+    SqlQuery query;
+    std::vector<Scan> scans;
+    std::vector<Edge> edges;
+    std::vector<Output> outputs;
+    std::vector<Bound> groupBy;
+    std::vector<std::pair<size_t, bool>> sortKeys; // output index, descending
+    std::vector<std::string> resultNames; // column of each output while building
+    bool aggregating;
+    std::vector<std::string> planLines;
+
+    const Column& column(const Bound &bound) const {
+        return static_cast<const Table&>(*scans[bound.scan].table).getColumn(bound.column);
+    }
+
+    static bool sameBound(const Bound &a, const Bound &b) {
+        return a.scan == b.scan && a.column == b.column;
+    }
+
+    Bound resolve(const SqlColumnRef &ref) const {
+        Bound bound = {scans.size(), ref.column};
+        for (size_t s = 0; s < scans.size(); s++) {
+            if (!ref.table.empty() && ref.table != scans[s].name) continue;
+            auto colNames = scans[s].table->getColumnNames();
+            if (std::find(colNames.begin(), colNames.end(), ref.column) == colNames.end()) continue;
+            if (bound.scan != scans.size()) {
+                throw std::runtime_error("Ambiguous column: " + ref.text());
+            }
+            bound.scan = s;
+        }
+        if (bound.scan == scans.size()) {
+            if (!ref.table.empty() && std::none_of(scans.begin(), scans.end(),
+                                                   [&](const Scan &scan) { return scan.name == ref.table; })) {
+                throw std::runtime_error("Unknown table in column reference: " + ref.text());
+            }
+            throw std::runtime_error("Column not found: " + ref.text());
+        }
+        return bound;
+    }
+
+    void noteRead(const Bound &bound) {
+        std::vector<std::string> &reads = scans[bound.scan].reads;
+        if (std::find(reads.begin(), reads.end(), bound.column) == reads.end()) {
+            reads.push_back(bound.column);
+        }
+    }
+
+    std::string qualified(const Bound &bound) const {
+        return scans.size() > 1 ? scans[bound.scan].name + "." + bound.column : bound.column;
+    }
+
+    void bindTables(const TableLookup &lookup) {
+        for (const auto& ref : query.tables) {
+            Scan scan;
+            scan.table = lookup(ref.first);
+            scan.name = ref.second.empty() ? ref.first : ref.second;
+            for (const auto& other : scans) {
+                if (other.name == scan.name) {
+                    throw std::runtime_error("Table used twice without an alias: " + scan.name);
+                }
+            }
+            scans.push_back(scan);
+        }
+    }
+
+    // Splits the conditions into per-table filters and join edges
+    void bindConditions() {
+        for (const auto& cond : query.conditions) {
+            Bound left = resolve(cond.left);
+            if (!cond.joinsColumns) {
+                Predicate p;
+                p.column = left.column;
+                p.opText = cond.opText;
+                p.op = cond.op;
+                p.value = cond.value;
+                scans[left.scan].filters.push_back(p);
+                continue;
+            }
+            Bound right = resolve(cond.right);
+            if (cond.op != OP_EQ || left.scan == right.scan) {
+                throw std::runtime_error("Only equality between columns of two tables is supported: " +
+                                         cond.left.text() + " " + cond.opText + " " + cond.right.text());
+            }
+            if (column(left).getType() != column(right).getType()) {
+                throw std::runtime_error("Cannot join columns of different types: " +
+                                         cond.left.text() + " = " + cond.right.text());
+            }
+            edges.push_back({left.scan, left.column, right.scan, right.column, false});
+            noteRead(left);
+            noteRead(right);
+        }
+    }
+
+    void bindOutputs() {
+        aggregating = !query.groupBy.empty();
+        for (const auto& item : query.items) {
+            aggregating = aggregating || !item.function.empty();
+        }
+        for (const auto& ref : query.groupBy) {
+            groupBy.push_back(resolve(ref));
+            noteRead(groupBy.back());
+        }
+        for (const auto& item : query.items) {
+            if (item.star) {
+                if (aggregating) {
+                    throw std::runtime_error("SELECT * cannot be combined with GROUP BY or aggregates");
+                }
+                for (size_t s = 0; s < scans.size(); s++) {
+                    for (const auto& colName : scans[s].table->getColumnNames()) {
+                        Bound bound = {s, colName};
+                        bool clash = false;
+                        for (size_t t = 0; t < scans.size(); t++) {
+                            auto names = scans[t].table->getColumnNames();
+                            clash = clash || (t != s && std::find(names.begin(), names.end(), colName) != names.end());
+                        }
+                        outputs.push_back({clash ? scans[s].name + "." + colName : colName, "", false, bound, false});
+                        noteRead(bound);
+                    }
+                }
+                continue;
+            }
+            Output output = {item.alias.empty() ? item.text() : item.alias, item.function, item.countAll,
+                             Bound{0, ""}, false};
+            if (!item.countAll) {
+                output.source = resolve(item.column);
+                noteRead(output.source);
+                if (item.function.empty() && aggregating &&
+                    std::none_of(groupBy.begin(), groupBy.end(),
+                                 [&](const Bound &b) { return sameBound(b, output.source); })) {
+                    throw std::runtime_error("Column must appear in GROUP BY or inside an aggregate: " + item.text());
+                }
+                if ((item.function == "sum" || item.function == "avg") &&
+                    column(output.source).getType() != TYPE_NUMBER) {
+                    throw std::runtime_error(toLower(item.function) + " needs a number column: " + item.column.text() +
+                                             " (set its type with -t)");
+                }
+            }
+            outputs.push_back(output);
+        }
+    }
+
+    // ORDER BY names an output by position, name or alias, or else a column,
+    // which is carried along as a hidden output
+    void bindOrder() {
+        for (const auto& item : query.orderBy) {
+            size_t index = outputs.size();
+            if (item.ordinal > 0) {
+                if (item.ordinal > outputs.size()) {
+                    throw std::runtime_error("ORDER BY position out of range: " + std::to_string(item.ordinal));
+                }
+                index = item.ordinal - 1;
+            } else {
+                for (size_t i = 0; i < outputs.size() && index == outputs.size(); i++) {
+                    if (!outputs[i].hidden && outputs[i].name == item.column.text()) index = i;
+                }
+                if (index == outputs.size()) {
+                    Bound bound = resolve(item.column);
+                    for (size_t i = 0; i < outputs.size() && index == outputs.size(); i++) {
+                        if (outputs[i].function.empty() && !outputs[i].countAll && sameBound(outputs[i].source, bound)) index = i;
+                    }
+                    if (index == outputs.size()) {
+                        if (aggregating && std::none_of(groupBy.begin(), groupBy.end(),
+                                                        [&](const Bound &b) { return sameBound(b, bound); })) {
+                            throw std::runtime_error("ORDER BY column must be grouped or selected: " + item.column.text());
+                        }
+                        outputs.push_back({item.column.text(), "", false, bound, true});
+                        noteRead(bound);
+                    }
+                }
+            }
+            sortKeys.push_back(std::make_pair(index, item.descending));
+        }
+    }
+
+    void runScans() {
+        for (auto& scan : scans) {
+            const Table &table = *scan.table;
+            if (scan.filters.empty()) {
+                scan.rows.resize(table.getRowCount());
+                for (size_t i = 0; i < scan.rows.size(); i++) scan.rows[i] = i;
+            } else {
+                scan.rows = table.filterRows(scan.filters, nullptr);
+            }
+            std::string line = "Scan " + table.getName();
+            if (scan.name != table.getName()) line += " as " + scan.name;
+            line += ": " + std::to_string(table.getRowCount()) + " rows";
+            for (size_t k = 0; k < scan.filters.size(); k++) {
+                line += (k == 0 ? ", where " : " and ") + scan.filters[k].describe();
+            }
+            line += " -> " + std::to_string(scan.rows.size()) + " rows";
+            if (!scan.reads.empty()) {
+                line += ", reads ";
+                for (size_t k = 0; k < scan.reads.size(); k++) line += (k > 0 ? ", " : "") + scan.reads[k];
+            }
+            planLines.push_back(line);
+        }
+    }
+
+    bool wholeClusteredOn(const Scan &scan, const std::string &colName) const {
+        return scan.filters.empty() && scan.table->getClusterKey() == colName && scan.table->clusterTailRows() == 0;
+    }
+
+    // Joins scan next into set on set's column oldBound = next's newColumn
+    void join(RowSet &set, const Bound &oldBound, size_t next, const std::string &newColumn) {
+        const Scan &scan = scans[next];
+        const Column &oldCol = column(oldBound);
+        const Column &newCol = static_cast<const Table&>(*scan.table).getColumn(newColumn);
+        size_t oldPos = set.position(oldBound.scan);
+        std::string description = qualified(oldBound) + " = " + scan.name + "." + newColumn;
+        RowSet joined;
+        joined.scans = set.scans;
+        joined.scans.push_back(next);
+        joined.rows.resize(joined.scans.size());
+        auto emit = [&](size_t i, size_t row) {
+            for (size_t k = 0; k < set.scans.size(); k++) joined.rows[k].push_back(set.rows[k][i]);
+            joined.rows.back().push_back(row);
+        };
+
+        if (set.scans.size() == 1 && wholeClusteredOn(scans[oldBound.scan], oldBound.column) &&
+            wholeClusteredOn(scan, newColumn)) {
+            std::vector<size_t> left, right;
+            Column::mergeJoin(oldCol, newCol, left, right);
+            joined.rows[0].swap(left);
+            joined.rows[1].swap(right);
+            planLines.push_back("Merge join " + description + " on cluster keys -> " +
+                                std::to_string(joined.size()) + " rows");
+            std::swap(set, joined);
+            return;
+        }
+
+        std::vector<uint64_t> oldHashes, newHashes;
+        oldCol.hash(oldHashes);
+        newCol.hash(newHashes);
+        const std::vector<size_t> &oldRows = set.rows[oldPos];
+        std::unordered_multimap<uint64_t, size_t> hashTable;
+        bool buildNew = scan.rows.size() <= set.size();
+        if (buildNew) {
+            hashTable.reserve(scan.rows.size());
+            for (size_t row : scan.rows) {
+                if (!newCol.isNull(row)) hashTable.emplace(newHashes[row], row);
+            }
+            for (size_t i = 0; i < oldRows.size(); i++) {
+                auto range = hashTable.equal_range(oldHashes[oldRows[i]]);
+                for (auto it = range.first; it != range.second; ++it) {
+                    if (oldCol.equalValues(oldRows[i], newCol, it->second)) emit(i, it->second);
+                }
+            }
+        } else {
+            hashTable.reserve(oldRows.size());
+            for (size_t i = 0; i < oldRows.size(); i++) {
+                if (!oldCol.isNull(oldRows[i])) hashTable.emplace(oldHashes[oldRows[i]], i);
+            }
+            for (size_t row : scan.rows) {
+                auto range = hashTable.equal_range(newHashes[row]);
+                for (auto it = range.first; it != range.second; ++it) {
+                    if (oldCol.equalValues(oldRows[it->second], newCol, row)) emit(it->second, row);
+                }
+            }
+        }
+        planLines.push_back("Hash join " + description + ", build on " +
+                            (buildNew ? scan.name : std::string("joined rows")) + " (" +
+                            std::to_string(buildNew ? scan.rows.size() : oldRows.size()) + " rows) -> " +
+                            std::to_string(joined.size()) + " rows");
+        std::swap(set, joined);
+    }
+
+    // Applies the join conditions between tables that are both already
+    // joined as filters on the joined rows
+    void applyClosedEdges(RowSet &set) {
+        for (auto& edge : edges) {
+            if (edge.applied) continue;
+            size_t a = set.position(edge.left), b = set.position(edge.right);
+            if (a == set.scans.size() || b == set.scans.size()) continue;
+            edge.applied = true;
+            const Column &left = column(Bound{edge.left, edge.leftColumn});
+            const Column &right = column(Bound{edge.right, edge.rightColumn});
+            RowSet kept;
+            kept.scans = set.scans;
+            kept.rows.resize(set.scans.size());
+            for (size_t i = 0; i < set.size(); i++) {
+                if (!left.equalValues(set.rows[a][i], right, set.rows[b][i])) continue;
+                for (size_t k = 0; k < set.scans.size(); k++) kept.rows[k].push_back(set.rows[k][i]);
+            }
+            planLines.push_back("Filter " + scans[edge.left].name + "." + edge.leftColumn + " = " +
+                                scans[edge.right].name + "." + edge.rightColumn + " -> " +
+                                std::to_string(kept.size()) + " rows");
+            std::swap(set, kept);
+        }
+    }
+
+    // Greedy join ordering by filtered table size
+    RowSet runJoins() {
+        size_t first = 0;
+        for (size_t s = 1; s < scans.size(); s++) {
+            if (scans[s].rows.size() < scans[first].rows.size()) first = s;
+        }
+        RowSet set;
+        set.scans.push_back(first);
+        set.rows.push_back(scans[first].rows);
+        while (set.scans.size() < scans.size()) {
+            Edge* best = nullptr;
+            bool bestLeftJoined = false;
+            for (auto& edge : edges) {
+                bool leftIn = set.position(edge.left) < set.scans.size();
+                bool rightIn = set.position(edge.right) < set.scans.size();
+                if (leftIn == rightIn) continue;
+                size_t candidate = leftIn ? edge.right : edge.left;
+                size_t bestCandidate = best ? (bestLeftJoined ? best->right : best->left) : 0;
+                if (!best || scans[candidate].rows.size() < scans[bestCandidate].rows.size()) {
+                    best = &edge;
+                    bestLeftJoined = leftIn;
+                }
+            }
+            if (!best) {
+                for (size_t s = 0; s < scans.size(); s++) {
+                    if (set.position(s) == set.scans.size()) {
+                        throw std::runtime_error("Table is not joined to the others: " + scans[s].name +
+                                                 " (add JOIN ... ON or a WHERE condition a.x = b.y)");
+                    }
+                }
+            }
+            best->applied = true;
+            if (bestLeftJoined) join(set, Bound{best->left, best->leftColumn}, best->right, best->rightColumn);
+            else join(set, Bound{best->right, best->rightColumn}, best->left, best->leftColumn);
+            applyClosedEdges(set);
+        }
+        return set;
+    }
+
+    static bool lessStored(ColumnType type, const StringRef &a, const StringRef &b) {
+        switch (type) {
+            case TYPE_NUMBER: return a.number() < b.number();
+            case TYPE_DATE: return a.integer() < b.integer();
+            default: return a < b;
+        }
+    }
+
+    // Aggregates without GROUP BY over a single table run on the column
+    // kernels directly
+    bool aggregateWithKernels(Table &result) {
+        if (!groupBy.empty() || scans.size() != 1) return false;
+        const Scan &scan = scans[0];
+        bool all = scan.filters.empty();
+        result.openRowGroup(0);
+        for (size_t j = 0; j < outputs.size(); j++) {
+            Aggregate agg;
+            if (outputs[j].countAll) {
+                agg.count = scan.rows.size();
+            } else {
+                const Column &col = column(outputs[j].source);
+                agg = all ? col.aggregate() : col.aggregate(scan.rows);
+            }
+            Table::appendAggregate(result.getColumn(resultNames[j]), outputs[j].function, &agg);
+        }
+        planLines.push_back("Aggregate with column kernels");
+        return true;
+    }
+
+    // Hash aggregation over the joined rows. Group keys are hashed with the
+    // column hash kernels and compared as stored values, and the groups are
+    // appended to result one output column at a time without formatting.
+    void aggregateRows(const RowSet &set, Table &result) {
+        if (aggregateWithKernels(result)) return;
+
+        size_t keyCount = groupBy.size();
+        std::vector<const Column*> keyCols(keyCount);
+        std::vector<const std::vector<size_t>*> keyRows(keyCount);
+        std::vector<std::vector<uint64_t>> keyHashes(keyCount);
+        for (size_t k = 0; k < keyCount; k++) {
+            keyCols[k] = &column(groupBy[k]);
+            keyRows[k] = &set.rows[set.position(groupBy[k].scan)];
+            keyCols[k]->hash(keyHashes[k]);
+        }
+        std::vector<size_t> aggOutputs;
+        std::vector<const Column*> aggCols;
+        std::vector<const std::vector<size_t>*> aggRows;
+        for (size_t j = 0; j < outputs.size(); j++) {
+            if (outputs[j].function.empty()) continue;
+            aggOutputs.push_back(j);
+            aggCols.push_back(outputs[j].countAll ? nullptr : &column(outputs[j].source));
+            aggRows.push_back(outputs[j].countAll ? nullptr : &set.rows[set.position(outputs[j].source.scan)]);
+        }
+        size_t aggCount = aggOutputs.size();
+
+        GroupTable groups;
+        std::vector<Aggregate> states;
+        auto sameGroup = [&](size_t a, size_t b) {
+            for (size_t k = 0; k < keyCount; k++) {
+                size_t ra = (*keyRows[k])[a], rb = (*keyRows[k])[b];
+                if (!keyCols[k]->sameKey(ra, rb)) return false;
+            }
+            return true;
+        };
+
+        std::vector<uint64_t> hashes;
+        size_t total = set.size();
+        for (size_t start = 0; start < total; start += VIEW_BATCH_SIZE) {
+            size_t count = std::min<size_t>(VIEW_BATCH_SIZE, total - start);
+            hashes.assign(count, 0);
+            for (size_t k = 0; k < keyCount; k++) {
+                for (size_t i = 0; i < count; i++) {
+                    hashes[i] = mix64(hashes[i] ^ keyHashes[k][(*keyRows[k])[start + i]]);
+                }
+            }
+            for (size_t i = 0; i < count; i++) {
+                size_t row = start + i;
+                size_t g = groups.insert(hashes[i], row, sameGroup);
+                if (groups.size() * aggCount > states.size()) states.resize(groups.size() * aggCount);
+                Aggregate* state = &states[g * aggCount];
+                for (size_t a = 0; a < aggCount; a++, state++) {
+                    if (!aggCols[a]) {
+                        state->count++;
+                        continue;
+                    }
+                    const StringRef* value = aggCols[a]->valueAt((*aggRows[a])[row]);
+                    if (!value) continue;
+                    ColumnType type = aggCols[a]->getType();
+                    if (state->count == 0 || lessStored(type, *value, state->min)) state->min = *value;
+                    if (state->count == 0 || lessStored(type, state->max, *value)) state->max = *value;
+                    state->count++;
+                    if (type == TYPE_NUMBER) state->sum += value->number();
+                }
+            }
+        }
+
+        // Without GROUP BY there is always exactly one group
+        if (keyCount == 0 && groups.size() == 0) {
+            states.resize(aggCount);
+        }
+        size_t groupCount = keyCount == 0 ? 1 : groups.size();
+        for (size_t group = 0; group * ROW_GROUP_SIZE < groupCount; group++) {
+            result.openRowGroup(group);
+        }
+        std::vector<size_t> groupRows(groupCount);
+        size_t a = 0;
+        for (size_t j = 0; j < outputs.size(); j++) {
+            Column &target = result.getColumn(resultNames[j]);
+            if (!outputs[j].function.empty()) {
+                for (size_t g = 0; g < groupCount; g++) {
+                    Table::appendAggregate(target, outputs[j].function, &states[g * aggCount + a]);
+                }
+                a++;
+                continue;
+            }
+            size_t k = 0;
+            while (!sameBound(groupBy[k], outputs[j].source)) k++;
+            for (size_t g = 0; g < groupCount; g++) groupRows[g] = (*keyRows[k])[groups.first(g)];
+            target.appendRows(*keyCols[k], groupRows, 0, groupCount);
+        }
+        std::string line = "Hash aggregate";
+        for (size_t k = 0; k < keyCount; k++) line += (k == 0 ? " by " : ", ") + qualified(groupBy[k]);
+        planLines.push_back(line + " -> " + std::to_string(groupCount) + " group(s)");
+    }
+
+    // Streams the joined rows batch by batch into result, copying the cell
+    // headers of the selected columns. Without sorting, LIMIT stops the
+    // stream.
+    void projectRows(const RowSet &set, Table &result) {
+        size_t wanted = sortKeys.empty() && query.hasLimit ? std::min(query.limit, set.size()) : set.size();
+        for (size_t start = 0; start < wanted; start += VIEW_BATCH_SIZE) {
+            size_t count = std::min<size_t>(VIEW_BATCH_SIZE, wanted - start);
+            if (start % ROW_GROUP_SIZE == 0) result.openRowGroup(start / ROW_GROUP_SIZE);
+            for (size_t j = 0; j < outputs.size(); j++) {
+                const std::vector<size_t> &rows = set.rows[set.position(outputs[j].source.scan)];
+                result.getColumn(resultNames[j]).appendRows(column(outputs[j].source), rows, start, count);
+            }
+        }
+    }
+
+    // Row order of result by the sort keys; ties keep their order. With a
+    // LIMIT only the first rows are fully sorted.
+    std::vector<size_t> sortResult(const Table &result) {
+        size_t total = result.getRowCount();
+        size_t keep = query.hasLimit ? std::min(query.limit, total) : total;
+        std::vector<size_t> order(total);
+        for (size_t i = 0; i < order.size(); i++) order[i] = i;
+        if (sortKeys.empty()) {
+            order.resize(keep);
+            return order;
+        }
+        std::vector<const Column*> keyCols;
+        for (const auto& key : sortKeys) keyCols.push_back(&result.getColumn(resultNames[key.first]));
+        auto before = [&](size_t a, size_t b) {
+            for (size_t k = 0; k < sortKeys.size(); k++) {
+                bool descending = sortKeys[k].second;
+                const StringRef* x = keyCols[k]->valueAt(a);
+                const StringRef* y = keyCols[k]->valueAt(b);
+                // NULLs sort first
+                if (!x || !y) {
+                    if (!x && y) return !descending;
+                    if (x && !y) return descending;
+                    continue;
+                }
+                ColumnType type = keyCols[k]->getType();
+                if (lessStored(type, *x, *y)) return !descending;
+                if (lessStored(type, *y, *x)) return descending;
+            }
+            return a < b;
+        };
+        if (keep < order.size()) {
+            std::partial_sort(order.begin(), order.begin() + keep, order.end(), before);
+        } else {
+            std::sort(order.begin(), order.end(), before);
+        }
+        order.resize(keep);
+        std::string line = "Sort by ";
+        for (size_t k = 0; k < sortKeys.size(); k++) {
+            line += (k > 0 ? ", " : "") + outputs[sortKeys[k].first].name + (sortKeys[k].second ? " desc" : "");
+        }
+        planLines.push_back(line);
+        return order;
+    }
+
+    ColumnType outputType(const Output &output) const {
+        if (output.function == "count" || output.function == "sum" || output.function == "avg") return TYPE_NUMBER;
+        return column(output.source).getType();
+    }
+
+public:
+    SqlEngine(const SqlQuery &parsed, const TableLookup &lookup) : query(parsed), aggregating(false) {
+        bindTables(lookup);
+        bindConditions();
+        bindOutputs();
+        bindOrder();
+    }
+
+    bool isExplain() const { return query.explain; }
+
+    // Steps in the order they ran, with the rows each produced
+    const std::vector<std::string>& plan() const { return planLines; }
+
+    // Builds every output, hidden ones included, as a typed column of an
+    // intermediate table, then copies the visible columns into the result
+    // in sorted order
+    Table run() {
+        runScans();
+        RowSet set = runJoins();
+        Table built("result");
+        for (size_t j = 0; j < outputs.size(); j++) {
+            resultNames.push_back(std::to_string(j));
+            built.addColumn(resultNames[j]);
+            built.setColumnType(resultNames[j], outputType(outputs[j]));
+        }
+        if (aggregating) aggregateRows(set, built);
+        else projectRows(set, built);
+        std::vector<size_t> order = sortResult(built);
+        if (query.hasLimit) planLines.push_back("Limit " + std::to_string(query.limit));
+
+        Table table("result");
+        std::vector<Column*> targets;
+        std::vector<const Column*> sources;
+        for (size_t j = 0; j < outputs.size(); j++) {
+            if (outputs[j].hidden) continue;
+            std::string name = outputs[j].name;
+            auto names = table.getColumnNames();
+            for (int n = 2; std::find(names.begin(), names.end(), name) != names.end(); n++) {
+                name = outputs[j].name + "_" + std::to_string(n);
+            }
+            table.addColumn(name);
+            table.setColumnType(name, outputType(outputs[j]));
+            targets.push_back(&table.getColumn(name));
+            sources.push_back(&built.getColumn(resultNames[j]));
+        }
+        for (size_t first = 0; first < order.size(); first += ROW_GROUP_SIZE) {
+            size_t count = std::min<size_t>(ROW_GROUP_SIZE, order.size() - first);
+            table.openRowGroup(first / ROW_GROUP_SIZE);
+            for (size_t k = 0; k < targets.size(); k++) {
+                targets[k]->appendRows(*sources[k], order, first, count);
+            }
+        }
+        return table;
+    }
+};
+
+// DatabaseManager class to handle multiple tables and commands
+class DatabaseManager {
+private:
+    // Tables are shared handles: a command holds its own reference for as
+    // long as it runs, so a reload can swap in a new version underneath it
+    // and the old one is freed when its last reader lets go. tablesMutex
+    // guards the map and currentTable, never a whole command.
+    std::map<std::string, std::shared_ptr<Table>> tables;
+    std::shared_ptr<Table> currentTable;
+    std::map<std::string, std::string> tableSources;
+    mutable std::mutex tablesMutex;
+    std::string dataDirectory;
+    std::map<std::string, CatalogEntry> catalog;
+
+    // A table being rebuilt from its file on a background thread
+    struct Reload {
+        std::string table;
+        std::string source;
+        std::string message;
+        std::thread worker;
+        std::atomic<bool> done{false};
+    };
+    std::vector<std::unique_ptr<Reload>> reloads;
+
+    std::shared_ptr<Table> current() const {
+        std::lock_guard<std::mutex> lock(tablesMutex);
+        if (!currentTable) {
+            throw std::runtime_error("No table selected");
+        }
+        return currentTable;
+    }
+
+    // The current table for commands that modify it. Edits made while a
+    // reload runs would be lost in the swap, so they are refused.
+    std::shared_ptr<Table> writableCurrent() const {
+        std::shared_ptr<Table> table = current();
+        checkNotReloading(table->getName());
+        return table;
+    }
+
+    void checkNotReloading(const std::string &tableName) const {
+        for (const auto& reload : reloads) {
+            if (!reload->done && reload->table == tableName) {
+                throw std::runtime_error("Table is being reloaded: " + tableName);
+            }
+        }
+    }
+
+    // Adds or replaces a table and makes it the current one
+    void installTable(std::shared_ptr<Table> table, const std::string &source = std::string()) {
+        std::lock_guard<std::mutex> lock(tablesMutex);
+        const std::string &name = table->getName();
+        if (source.empty()) {
+            tableSources.erase(name);
+        } else {
+            tableSources[name] = source;
+        }
+        tables[name] = table;
+        currentTable = std::move(table);
+    }
+
+    std::shared_ptr<Table> findLoaded(const std::string &tableName) const {
+        std::lock_guard<std::mutex> lock(tablesMutex);
+        auto it = tables.find(tableName);
+        return it == tables.end() ? nullptr : it->second;
+    }
+
+    std::shared_ptr<Table> findTable(const std::string &tableName) const {
+        std::shared_ptr<Table> table = findLoaded(tableName);
+        if (!table) {
+            throw std::runtime_error("Table not found: " + tableName);
+        }
+        return table;
+    }
+
+    // The loaded tables in name order, each held for the caller
+    std::vector<std::shared_ptr<Table>> tableHandles() const {
+        std::lock_guard<std::mutex> lock(tablesMutex);
+        std::vector<std::shared_ptr<Table>> handles;
+        for (const auto& pair : tables) {
+            handles.push_back(pair.second);
+        }
+        return handles;
+    }
+
+    // Background half of --reload: parses the file, then swaps the new
+    // version in under the lock. The old version is released here, off the
+    // command thread, unless a reader still holds it.
+    void runReload(Reload &job) {
+        try {
+            auto start = std::chrono::steady_clock::now();
+            auto fresh = std::make_shared<Table>(Table::loadFromFile(job.source));
+            if (fresh->getName() != job.table) {
+                throw std::runtime_error("'" + job.source + "' now holds table '" + fresh->getName() + "'");
+            }
+            size_t rowCount = fresh->getRowCount();
+            std::shared_ptr<Table> previous;
+            {
+                std::lock_guard<std::mutex> lock(tablesMutex);
+                auto it = tables.find(job.table);
+                if (it == tables.end()) {
+                    throw std::runtime_error("table was removed while reloading");
+                }
+                previous = it->second;
+                if (currentTable == previous) currentTable = fresh;
+                it->second = std::move(fresh);
+            }
+            previous.reset();
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            std::ostringstream message;
+            message << "Table '" << job.table << "' reloaded from '" << job.source << "' ("
+                    << rowCount << " rows in " << std::fixed << std::setprecision(1) << ms << " ms).";
+            job.message = message.str();
+        } catch (const std::exception &e) {
+            job.message = "Error: Reload of '" + job.table + "' failed: " + e.what();
+        }
+        job.done = true;
+    }
+
+    static CatalogEntry readCatalogEntry(const std::filesystem::path &path) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open()) {
+            throw std::runtime_error("Cannot open file: " + path.string());
+        }
+        StreamLineReader lines(file);
+        CatalogEntry entry;
+        Table header = Table::readHeader(lines, entry.rowCount);
+        entry.name = header.getName();
+        entry.path = path.string();
+        entry.columns = header.getColumnNames();
+        for (const auto& colName : entry.columns) {
+            entry.types.push_back(static_cast<const Table&>(header).getColumn(colName).getType());
+        }
+        entry.bytes = std::filesystem::file_size(path);
+        // file_time_type has no portable epoch in C++17; shift it onto the
+        // system clock
+        auto written = std::filesystem::last_write_time(path);
+        entry.modified = std::chrono::system_clock::to_time_t(
+            std::chrono::time_point_cast<std::chrono::system_clock::duration>(
+                written - std::filesystem::file_time_type::clock::now() + std::chrono::system_clock::now()));
+        entry.indexed = std::filesystem::exists(path.string() + ".idx");
+        return entry;
+    }
+    
+    // Falls back to the .odt extension when filename does not exist as given
+    static std::string resolveTableFile(const std::string &filename) {
+        if (fileExists(filename)) {
+            return filename;
+        }
+        if (!fileExists(filename + ".odt")) {
+            throw std::runtime_error("Cannot open file: " + filename +
+                                     " (also tried: " + filename + ".odt)");
+        }
+        return filename + ".odt";
+    }
+    
+    static const Column& findColumn(const Table &table, const std::string &colName) {
+        auto colNames = table.getColumnNames();
+        if (std::find(colNames.begin(), colNames.end(), colName) == colNames.end()) {
+            throw std::runtime_error("Column not found: " + colName);
+        }
+        return table.getColumn(colName);
+    }
+
+    static const Column& dateColumn(const Table &table, const std::string &colName) {
+        const Column &col = findColumn(table, colName);
+        if (col.getType() != TYPE_DATE) {
+            throw std::runtime_error("Column is not a date column: " + colName);
+        }
+        return col;
+    }
+    
+    // Reads <column> <op> <value> starting at args[at]
+    static Predicate parsePredicate(const std::vector<std::string> &args, size_t at) {
+        Predicate p;
+        p.column = args[at];
+        p.opText = args[at + 1];
+        p.value = args[at + 2];
+        if (!parseCompareOp(p.opText, p.op)) {
+            throw std::runtime_error("Unknown operator: " + p.opText + " (use =, !=, <, <=, >, >=, like)");
+        }
+        return p;
+    }
+    
+    static void printFilterPlan(const std::vector<Predicate> &predicates) {
+        if (predicates.empty()) {
+            std::cout << "No filter conditions." << std::endl;
+            return;
+        }
+        size_t width = 0;
+        for (const auto& p : predicates) width = std::max(width, p.describe().size());
+        std::cout << "Filter order:" << std::endl;
+        for (size_t i = 0; i < predicates.size(); i++) {
+            const Predicate &p = predicates[i];
+            std::cout << "  " << (i + 1) << ". " << std::setw(width) << std::left << p.describe();
+            if (p.evaluated) {
+                std::cout << "  est. " << std::fixed << std::setprecision(1) << p.selectivity * 100
+                          << "% pass, cost " << p.cost << " -> " << p.matched << " row(s)";
+                std::cout.unsetf(std::ios::floatfield);
+                std::cout << std::setprecision(6);
+            } else {
+                std::cout << "  skipped, no rows left";
+            }
+            std::cout << std::endl;
+        }
+    }
+    
+    // Narrows a selection to the given ascending rows
+    static void restrictSelection(Selection &sel, std::vector<size_t> &rows) {
+        if (!sel.allRows) {
+            std::vector<size_t> both;
+            std::set_intersection(sel.rows.begin(), sel.rows.end(), rows.begin(), rows.end(),
+                                  std::back_inserter(both));
+            rows.swap(both);
+        }
+        sel.allRows = false;
+        sel.rows.swap(rows);
+    }
+    
+    static std::string sharedSegmentName(const std::string &tableName) {
+        return "/" + toLower(SOFTWARE_NAME) + "." + tableName;
+    }
+    
+public:
+    DatabaseManager() = default;
+    DatabaseManager(const DatabaseManager&) = delete;
+    DatabaseManager& operator=(const DatabaseManager&) = delete;
+
+    // Waits for reloads still running so none outlives the tables it swaps
+    ~DatabaseManager() {
+        for (auto& reload : reloads) {
+            reload->worker.join();
+        }
+    }
+
+    void createTable(const std::string &tableName, const std::vector<std::string> &columns) {
+        {
+            std::lock_guard<std::mutex> lock(tablesMutex);
+            if (tables.find(tableName) != tables.end()) {
+                throw std::runtime_error("Table already exists: " + tableName);
+            }
+        }
+        
+        auto newTable = std::make_shared<Table>(tableName);
+        for (const auto& col : columns) {
+            newTable->addColumn(col);
+        }
+        
+        installTable(newTable);
+        std::cout << "Table '" << tableName << "' created successfully." << std::endl;
+    }
+    
+    void loadTable(const std::string &filename) {
+        loadTables(std::vector<std::string>(1, filename));
+    }
+    
+    // Loads every file matching the given names or glob patterns. Files are
+    // parsed concurrently and inserted in argument order once all are done;
+    // the last table loaded becomes the current one.
+    void loadTables(const std::vector<std::string> &patterns) {
+        std::vector<std::string> filenames;
+        for (const auto& pattern : patterns) {
+            std::vector<std::string> matches = expandPattern(pattern);
+            filenames.insert(filenames.end(), matches.begin(), matches.end());
+        }
+        
+        struct LoadResult {
+            Table table;
+            std::string filename;
+            std::string error;
+            size_t bytes = 0;
+            double seconds = 0;
+        };
+        std::vector<LoadResult> results(filenames.size());
+        parallelFor(filenames.size(), [&](size_t i) {
+            LoadResult &result = results[i];
+            auto start = std::chrono::steady_clock::now();
+            try {
+                result.filename = resolveTableFile(filenames[i]);
+                result.table = Table::loadFromFile(result.filename);
+                std::ifstream file(result.filename, std::ios::binary | std::ios::ate);
+                result.bytes = static_cast<size_t>(file.tellg());
+            } catch (const std::exception &e) {
+                result.error = e.what();
+            }
+            result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        });
+        
+        for (auto& result : results) {
+            if (!result.error.empty()) {
+                if (filenames.size() == 1) throw std::runtime_error(result.error);
+                std::cout << "Error: " << result.error << std::endl;
+                continue;
+            }
+            std::string tableName = result.table.getName();
+            size_t rowCount = result.table.getRowCount();
+            installTable(std::make_shared<Table>(std::move(result.table)), result.filename);
+            std::cout << "Table '" << tableName << "' loaded successfully from '"
+                      << result.filename << "'";
+            if (filenames.size() > 1) {
+                double megabytes = result.bytes / (1024.0 * 1024.0);
+                std::cout << std::fixed << std::setprecision(1) << " (" << rowCount << " rows, "
+                          << megabytes << " MB in " << result.seconds * 1000.0 << " ms, "
+                          << (result.seconds > 0 ? megabytes / result.seconds : 0.0) << " MB/s)";
+                std::cout.unsetf(std::ios::floatfield);
+            }
+            std::cout << "." << std::endl;
+        }
+    }
+    
+    // Re-reads a table from the file it was loaded from on a background
+    // thread. Queries keep using the current version until the new one is
+    // swapped in.
+    void reloadTable(const std::string &tableName) {
+        std::string source;
+        {
+            std::lock_guard<std::mutex> lock(tablesMutex);
+            if (tables.find(tableName) == tables.end()) {
+                throw std::runtime_error("Table not found: " + tableName);
+            }
+            auto it = tableSources.find(tableName);
+            if (it == tableSources.end()) {
+                throw std::runtime_error("Table was not loaded from a file: " + tableName);
+            }
+            source = it->second;
+        }
+        for (const auto& reload : reloads) {
+            if (!reload->done && reload->table == tableName) {
+                throw std::runtime_error("Table is already being reloaded: " + tableName);
+            }
+        }
+
+        auto reload = std::make_unique<Reload>();
+        reload->table = tableName;
+        reload->source = source;
+        Reload &job = *reload;
+        reloads.push_back(std::move(reload));
+        job.worker = std::thread([this, &job]() { runReload(job); });
+        std::cout << "Reloading table '" << tableName << "' from '" << source
+                  << "' in the background." << std::endl;
+    }
+
+    // Reports reloads that have finished since the last command
+    void finishReloads() {
+        for (auto it = reloads.begin(); it != reloads.end();) {
+            Reload &job = **it;
+            if (!job.done) {
+                ++it;
+                continue;
+            }
+            job.worker.join();
+            std::cout << job.message << std::endl;
+            auto entry = catalog.find(job.table);
+            if (entry != catalog.end() && entry->second.path == job.source) {
+                try {
+                    entry->second = readCatalogEntry(job.source);
+                } catch (const std::exception&) {
+                    // Keep the old metadata; the file is read again on --catalog
+                }
+            }
+            it = reloads.erase(it);
+        }
+    }
+
+    // Publishes a loaded table into a POSIX shared-memory segment so other
+    // RowDB processes on this host can attach to it without re-parsing
+    void publishTable(const std::string &tableName) {
+        std::shared_ptr<Table> table = findTable(tableName);
+#ifdef _WIN32
+        throw std::runtime_error("Shared-memory publishing is not supported on this platform");
+#else
+        std::string segment = sharedSegmentName(tableName);
+        size_t size = table->writeImage(nullptr);
+        // Attached tables point into the old segment, so republishing
+        // replaces it with a new one instead of truncating it under them
+        shm_unlink(segment.c_str());
+        int fd = shm_open(segment.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+        if (fd < 0) {
+            throw std::runtime_error("Cannot create shared memory segment: " + segment);
+        }
+        if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+            close(fd);
+            shm_unlink(segment.c_str());
+            throw std::runtime_error("Cannot resize shared memory segment: " + segment);
+        }
+        void* mem = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (mem == MAP_FAILED) {
+            shm_unlink(segment.c_str());
+            throw std::runtime_error("Cannot map shared memory segment: " + segment);
+        }
+        table->writeImage(static_cast<char*>(mem));
+        munmap(mem, size);
+        std::cout << "Table '" << tableName << "' published to '" << segment
+                  << "' (" << size << " bytes)." << std::endl;
+#endif
+    }
+    
+    // Attaches read-only to a table another process published
+    void attachTable(const std::string &tableName) {
+#ifdef _WIN32
+        throw std::runtime_error("Shared-memory publishing is not supported on this platform");
+#else
+        std::string segment = sharedSegmentName(tableName);
+        int fd = shm_open(segment.c_str(), O_RDONLY, 0);
+        if (fd < 0) {
+            throw std::runtime_error("No published table named: " + tableName);
+        }
+        // The table keeps the segment mapped, so long values are shared
+        // with the publisher instead of copied
+        auto mapping = std::make_shared<MappedFile>(fd, "shared memory segment " + segment);
+        if (mapping->size() == 0) {
+            throw std::runtime_error("Shared memory segment is empty: " + segment);
+        }
+        auto table = std::make_shared<Table>(Table::fromImage(mapping->data(), mapping->size(), mapping));
+        installTable(table);
+        std::cout << "Table '" << table->getName() << "' attached from '" << segment << "'." << std::endl;
+#endif
+    }
+    
+    // Removes a published segment; processes already attached are unaffected
+    void unpublishTable(const std::string &tableName) {
+#ifdef _WIN32
+        throw std::runtime_error("Shared-memory publishing is not supported on this platform");
+#else
+        std::string segment = sharedSegmentName(tableName);
+        if (shm_unlink(segment.c_str()) != 0) {
+            throw std::runtime_error("No published table named: " + tableName);
+        }
+        std::cout << "Table '" << tableName << "' unpublished." << std::endl;
+#endif
+    }
+    
+    // Snapshot file layout: "RDBSNAP2" | u32 tableCount | u32 reserved |
+    // current table name | per table: source file | u64 imageSize | image.
+    // Images stay 8-byte aligned so a restore can decode straight from the
+    // mapped file; "RDBSNAP1" snapshots have no source files.
+    void saveSnapshot(const std::string &filename) {
+        std::string current = getCurrentTableName();
+        std::vector<std::shared_ptr<Table>> order = tableHandles();
+        std::vector<std::string> sources;
+        {
+            std::lock_guard<std::mutex> lock(tablesMutex);
+            for (const auto& table : order) {
+                auto it = tableSources.find(table->getName());
+                sources.push_back(it == tableSources.end() ? std::string() : it->second);
+            }
+        }
+        std::vector<size_t> imageSizes;
+        ImageWriter sizer(nullptr);
+        sizer.bytes("RDBSNAP2", 8);
+        sizer.u32(0);
+        sizer.u32(0);
+        sizer.str(current);
+        for (size_t i = 0; i < order.size(); i++) {
+            imageSizes.push_back(order[i]->writeImage(nullptr));
+            sizer.str(sources[i]);
+            sizer.u64(0);
+            sizer.skip(imageSizes.back());
+        }
+        
+        std::string tempFilename = filename + ".tmp";
+        writeFileWith(tempFilename, sizer.size(), [&](char* out) {
+            ImageWriter writer(out);
+            writer.bytes("RDBSNAP2", 8);
+            writer.u32(static_cast<uint32_t>(order.size()));
+            writer.u32(0);
+            writer.str(current);
+            for (size_t i = 0; i < order.size(); i++) {
+                writer.str(sources[i]);
+                writer.u64(imageSizes[i]);
+                order[i]->writeImage(out + writer.size());
+                writer.skip(imageSizes[i]);
+            }
+        });
+        std::remove(filename.c_str());
+        if (std::rename(tempFilename.c_str(), filename.c_str()) != 0) {
+            throw std::runtime_error("Cannot write snapshot: " + filename);
+        }
+        std::cout << "Snapshot of " << order.size() << " table(s) saved to '" << filename
+                  << "' (" << sizer.size() << " bytes)." << std::endl;
+    }
+    
+    // Replaces all loaded tables with the contents of a snapshot. The tables
+    // keep the file mapped and read long values from it in place; cell
+    // headers are rebuilt, and cracker indexes start over from scratch.
+    void restoreSnapshot(const std::string &filename) {
+        auto mapping = std::make_shared<MappedFile>(filename);
+        const MappedFile &file = *mapping;
+        ImageReader reader(file.data(), file.size());
+        const char* magic = file.size() < 8 ? nullptr : reader.take(8);
+        bool withSources = magic && std::memcmp(magic, "RDBSNAP2", 8) == 0;
+        if (!withSources && (!magic || std::memcmp(magic, "RDBSNAP1", 8) != 0)) {
+            throw std::runtime_error("Invalid snapshot file: " + filename);
+        }
+        uint32_t tableCount = reader.u32();
+        reader.u32();
+        std::string current = reader.str();
+        
+        std::map<std::string, std::shared_ptr<Table>> restored;
+        std::map<std::string, std::string> sources;
+        for (uint32_t i = 0; i < tableCount; i++) {
+            std::string source = withSources ? reader.str() : std::string();
+            uint64_t imageSize = reader.u64();
+            const char* image = reader.take(imageSize);
+            auto table = std::make_shared<Table>(Table::fromImage(image, imageSize, mapping));
+            restored[table->getName()] = table;
+            if (!source.empty()) sources[table->getName()] = source;
+        }
+        
+        std::lock_guard<std::mutex> lock(tablesMutex);
+        tables.swap(restored);
+        tableSources.swap(sources);
+        currentTable = nullptr;
+        auto it = tables.find(current);
+        if (it != tables.end()) {
+            currentTable = it->second;
+        }
+        std::cout << "Restored " << tables.size() << " table(s) from '" << filename << "'." << std::endl;
+    }
+    
+    // Runs a SELECT statement over the loaded tables and shows the result,
+    // or with EXPLAIN the steps it took
+    void runSql(const std::string &text) {
+        auto start = std::chrono::steady_clock::now();
+        SqlEngine engine(SqlParser(text).parse(), [this](const std::string &tableName) { return findTable(tableName); });
+        Table result = engine.run();
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (engine.isExplain()) {
+            std::cout << "Plan:" << std::endl;
+            for (size_t i = 0; i < engine.plan().size(); i++) {
+                std::cout << "  " << (i + 1) << ". " << engine.plan()[i] << std::endl;
+            }
+        } else {
+            result.displayASCII();
+        }
+        std::cout << result.getRowCount() << " row(s) in " << std::fixed << std::setprecision(1) << ms << " ms." << std::endl;
+        std::cout.unsetf(std::ios::floatfield);
+        std::cout << std::setprecision(6);
+    }
+    
+    // Sorts a table by a key column and keeps it sorted, or with "off"
+    // stops maintaining the order
+    void clusterTable(const std::string &tableName, const std::vector<std::string> &args) {
+        std::shared_ptr<Table> table = findTable(tableName);
+        checkNotReloading(tableName);
+        if (args.size() == 1 && toLower(args[0]) == "off") {
+            table->clusterBy("");
+            std::cout << "Table '" << tableName << "' is no longer clustered." << std::endl;
+            return;
+        }
+        if (args.size() != 2 || toLower(args[0]) != "on") {
+            throw std::runtime_error("Usage: --cluster <table> on <column> | off");
+        }
+        auto start = std::chrono::steady_clock::now();
+        table->clusterBy(args[1]);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "Table '" << tableName << "' clustered on '" << args[1] << "' ("
+                  << table->getRowCount() << " rows in " << std::fixed << std::setprecision(1) << ms << " ms)." << std::endl;
+        std::cout.unsetf(std::ios::floatfield);
+        std::cout << std::setprecision(6);
+    }
+    
+    // Reads agg(<col>) or count(*), e.g. sum(amount)
+    static AggregateSpec parseAggregate(const std::string &text) {
+        AggregateSpec agg;
+        size_t open = text.find('(');
+        if (open == std::string::npos || text.back() != ')') {
+            throw std::runtime_error("Invalid aggregate: " + text + " (e.g. sum(amount) or count(*))");
+        }
+        agg.function = toLower(text.substr(0, open));
+        agg.column = text.substr(open + 1, text.size() - open - 2);
+        if (agg.column == "*") agg.column.clear();
+        if (agg.function != "count" && agg.function != "sum" && agg.function != "avg" &&
+            agg.function != "min" && agg.function != "max") {
+            throw std::runtime_error("Unknown aggregate: " + agg.function + " (use count, sum, avg, min or max)");
+        }
+        return agg;
+    }
+    
+    // Buckets the current table by a date column into a new table
+    // <name>_resample, which becomes the current one:
+    // <timecol> [n]<unit> [agg(<col>) ...] [fill]
+    void resampleTable(const std::vector<std::string> &args) {
+        std::string interval = toLower(args[1]);
+        size_t digits = 0;
+        while (digits < interval.size() && std::isdigit(static_cast<unsigned char>(interval[digits]))) digits++;
+        size_t step = 1;
+        if (digits > 0 && (!parseUnsigned(interval.substr(0, digits), step) || step == 0)) {
+            throw std::runtime_error("Invalid interval: " + args[1]);
+        }
+        std::string unitName = interval.substr(digits);
+        if (unitName.size() > 1 && unitName.back() == 's') unitName.pop_back();
+        TimeUnit unit;
+        if (!parseTimeUnit(unitName, unit)) {
+            throw std::runtime_error("Unknown interval: " + args[1] + " (use [n]minute, hour, day or month)");
+        }
+        std::vector<AggregateSpec> aggs;
+        bool fill = false;
+        for (size_t i = 2; i < args.size(); i++) {
+            if (toLower(args[i]) == "fill") fill = true;
+            else aggs.push_back(parseAggregate(args[i]));
+        }
+        if (aggs.empty()) aggs.push_back(AggregateSpec());
+        std::shared_ptr<Table> table = current();
+        std::string resampleName = table->getName() + "_resample";
+        if (findLoaded(resampleName)) checkNotReloading(resampleName);
+        auto start = std::chrono::steady_clock::now();
+        size_t skipped;
+        auto resampled = std::make_shared<Table>(table->resample(resampleName, args[0], unit, static_cast<int64_t>(step), aggs, fill, skipped));
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        installTable(resampled);
+        std::cout << "Table '" << resampleName << "' created with " << resampled->getRowCount() << " bucket(s) from "
+                  << table->getRowCount() - skipped << " row(s) in " << std::fixed << std::setprecision(1) << ms << " ms";
+        std::cout.unsetf(std::ios::floatfield);
+        std::cout << std::setprecision(6);
+        if (skipped > 0) std::cout << "; " << skipped << " row(s) without a time were skipped";
+        std::cout << "." << std::endl;
+    }
+    
+    // Pivots the current table into a new table <name>_pivot, which
+    // becomes the current one: rows=<col> cols=<col> [value=agg(<col>)]
+    void pivotTable(const std::vector<std::string> &args) {
+        PivotSpec spec;
+        for (const auto& arg : args) {
+            size_t equals = arg.find('=');
+            std::string key = toLower(arg.substr(0, equals));
+            std::string text = equals == std::string::npos ? "" : arg.substr(equals + 1);
+            if (key == "rows") {
+                spec.rows = text;
+            } else if (key == "cols") {
+                spec.cols = text;
+            } else if (key == "value") {
+                AggregateSpec agg = parseAggregate(text);
+                spec.function = agg.function;
+                spec.value = agg.column;
+            } else {
+                throw std::runtime_error("Usage: --pivot rows=<col> cols=<col> [value=agg(<col>)]");
+            }
+        }
+        if (spec.rows.empty() || spec.cols.empty()) {
+            throw std::runtime_error("Usage: --pivot rows=<col> cols=<col> [value=agg(<col>)]");
+        }
+        std::shared_ptr<Table> table = current();
+        std::string pivotName = table->getName() + "_pivot";
+        if (findLoaded(pivotName)) checkNotReloading(pivotName);
+        auto start = std::chrono::steady_clock::now();
+        auto pivoted = std::make_shared<Table>(table->pivot(pivotName, spec));
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        installTable(pivoted);
+        std::cout << "Table '" << pivotName << "' created with " << pivoted->getRowCount() << " row(s) and "
+                  << pivoted->getColumnNames().size() - 1 << " pivot column(s) from " << table->getRowCount()
+                  << " row(s) in " << std::fixed << std::setprecision(1) << ms << " ms." << std::endl;
+        std::cout.unsetf(std::ios::floatfield);
+        std::cout << std::setprecision(6);
+    }
+    
+    // Takes a random sample of the current table, or of a saved file
+    // without loading it, as a new table <name>_sample that replaces any
+    // earlier sample of the same table and becomes the current one
+    void sampleRows(const std::string &sizeText, const std::string &filename) {
+        SampleSize size;
+        if (!sizeText.empty() && sizeText.back() == '%') {
+            double percent;
+            if (!parseNumber(sizeText.data(), sizeText.data() + sizeText.size() - 1, percent) ||
+                !(percent > 0 && percent <= 100)) {
+                throw std::runtime_error("Invalid sample percentage: " + sizeText);
+            }
+            size.percent = percent;
+        } else if (!parseUnsigned(sizeText, size.count)) {
+            throw std::runtime_error("Invalid sample size: " + sizeText + " (use a row count or a percentage like 1%)");
+        }
+        uint64_t seed = (static_cast<uint64_t>(std::random_device()()) << 32) ^ std::random_device()();
+        auto start = std::chrono::steady_clock::now();
+        size_t totalRows;
+        std::shared_ptr<Table> sampled;
+        if (filename.empty()) {
+            std::shared_ptr<Table> table = current();
+            totalRows = table->getRowCount();
+            sampled = std::make_shared<Table>(table->sample(table->getName() + "_sample", size, seed));
+        } else {
+            sampled = std::make_shared<Table>(Table::sampleFile(resolveTableFile(filename), size, seed, totalRows));
+            sampled->setName(sampled->getName() + "_sample");
+        }
+        if (findLoaded(sampled->getName())) checkNotReloading(sampled->getName());
+        installTable(sampled);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "Table '" << sampled->getName() << "' created with " << sampled->getRowCount() << " of "
+                  << totalRows << " row(s) in " << std::fixed << std::setprecision(1) << ms << " ms." << std::endl;
+        std::cout.unsetf(std::ios::floatfield);
+        std::cout << std::setprecision(6);
+    }
+    
+    // Merge-joins the current table with another on their cluster keys
+    // into a new table named <current>_<other>
+    void joinTables(const std::string &otherName) {
+        std::shared_ptr<Table> left = current();
+        std::shared_ptr<Table> right = findTable(otherName);
+        std::string joinName = left->getName() + "_" + right->getName();
+        if (findLoaded(joinName)) {
+            throw std::runtime_error("Table already exists: " + joinName);
+        }
+        for (const auto& table : {left, right}) {
+            if (table->clusterTailRows() > 0) {
+                checkNotReloading(table->getName());
+                table->mergeClusterTail();
+            }
+        }
+        auto joined = std::make_shared<Table>(Table::mergeJoin(*left, *right, joinName));
+        installTable(joined);
+        std::cout << "Table '" << joinName << "' created with " << joined->getRowCount()
+                  << " row(s) joined on " << left->getClusterKey() << " = " << otherName << "."
+                  << right->getClusterKey() << "." << std::endl;
+    }
+    
+    // Adds a window column to the current table:
+    // <column> <function> [by <col>] [order <col> [asc|desc]] where function
+    // is row_number, rank, cumsum(<col>) or moving_avg(<col>,<rows>)
+    void addWindowColumn(const std::vector<std::string> &args) {
+        const std::string usage = "Usage: --window <column> <function> [by <col>] [order <col> [asc|desc]]";
+        if (args.size() < 2) throw std::runtime_error(usage);
+        WindowSpec spec;
+        std::string function = toLower(args[1]);
+        std::vector<std::string> inputs;
+        size_t open = function.find('(');
+        if (open != std::string::npos) {
+            if (function.back() != ')') throw std::runtime_error("Invalid window function: " + args[1]);
+            std::string inside = args[1].substr(open + 1, args[1].size() - open - 2);
+            if (!inside.empty()) inputs = split(inside, ',');
+            function = function.substr(0, open);
+        }
+        size_t expected = 0;
+        if (function == "row_number") {
+            spec.function = WINDOW_ROW_NUMBER;
+        } else if (function == "rank") {
+            spec.function = WINDOW_RANK;
+        } else if (function == "cumsum") {
+            spec.function = WINDOW_CUMSUM;
+            expected = 1;
+        } else if (function == "moving_avg") {
+            spec.function = WINDOW_MOVING_AVG;
+            expected = 2;
+        } else {
+            throw std::runtime_error("Unknown window function: " + function + " (use row_number, rank, cumsum or moving_avg)");
+        }
+        if (inputs.size() != expected) {
+            throw std::runtime_error("Wrong number of arguments for " + function);
+        }
+        if (expected > 0) spec.source = inputs[0];
+        if (expected > 1 && (!parseUnsigned(inputs[1], spec.frame) || spec.frame == 0)) {
+            throw std::runtime_error("Invalid moving average size: " + inputs[1]);
+        }
+        for (size_t i = 2; i < args.size(); i++) {
+            std::string word = toLower(args[i]);
+            if (word == "by" && i + 1 < args.size()) {
+                spec.partition = args[++i];
+            } else if (word == "order" && i + 1 < args.size()) {
+                spec.order = args[++i];
+                if (i + 1 < args.size() && (toLower(args[i + 1]) == "asc" || toLower(args[i + 1]) == "desc")) {
+                    spec.descending = toLower(args[++i]) == "desc";
+                }
+            } else {
+                throw std::runtime_error(usage);
+            }
+        }
+        std::shared_ptr<Table> table = writableCurrent();
+        auto start = std::chrono::steady_clock::now();
+        size_t partitions = table->addWindowColumn(args[0], spec);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "Column '" << args[0] << "' added over " << partitions << " partition(s) in "
+                  << std::fixed << std::setprecision(1) << ms << " ms." << std::endl;
+        std::cout.unsetf(std::ios::floatfield);
+        std::cout << std::setprecision(6);
+    }
+    
+    // Turns building crackers on repeated selects on or off
+    void setCracking(const std::string &mode) {
+        if (mode != "on" && mode != "off") {
+            throw std::runtime_error("Invalid cracking mode: " + mode + " (use on or off)");
+        }
+        Column::crackingEnabled() = mode == "on";
+        std::cout << "Adaptive indexing " << (mode == "on" ? "enabled" : "disabled") << "." << std::endl;
+    }
+    
+    // Chooses where large column buffers allocated from now on are placed
+    void setNumaPolicy(const std::string &policy) {
+        size_t node;
+        if (policy == "off") {
+            PageAllocator::setNumaPolicy(PageAllocator::NUMA_OFF, 0);
+            std::cout << "NUMA placement disabled." << std::endl;
+        } else if (policy == "interleave") {
+            PageAllocator::setNumaPolicy(PageAllocator::NUMA_INTERLEAVE, 0);
+            std::cout << "Large buffers will be interleaved across "
+                      << PageAllocator::nodeCount() << " NUMA node(s)." << std::endl;
+        } else if (parseUnsigned(policy, node) && node < static_cast<size_t>(PageAllocator::nodeCount())) {
+            PageAllocator::setNumaPolicy(PageAllocator::NUMA_BIND, static_cast<int>(node));
+            std::cout << "Large buffers will be bound to NUMA node " << policy << "." << std::endl;
+        } else {
+            throw std::runtime_error("Invalid NUMA policy: " + policy + " (use off, interleave or a node number)");
+        }
+    }
+    
+    // Saves the current table; options are view options plus --index, which
+    // also writes a row index sidecar for --peek
+    void saveTable(const std::string &filename, std::vector<std::string> options = std::vector<std::string>()) {
+        std::shared_ptr<Table> table = current();
+        size_t indexInterval = 0;
+        auto indexOption = std::find(options.begin(), options.end(), "--index");
+        if (indexOption != options.end()) {
+            indexInterval = ROW_INDEX_INTERVAL;
+            options.erase(indexOption);
+        }
+        Selection sel = parseSelection(*table, options, 0);
+        table->saveToFile(filename, sel, indexInterval);
+        if (sel.allRows) {
+            std::cout << "Table saved to '" << filename << "' successfully." << std::endl;
+        } else {
+            std::cout << sel.rows.size() << " row(s) saved to '" << filename << "' successfully." << std::endl;
+        }
+    }
+    
+    // Builds a selection of the current table from the --rows, --where, --cols and --explain options
+    static Selection parseSelection(const Table &table, const std::vector<std::string> &args, size_t start) {
+        Selection sel;
+        std::vector<Predicate> predicates;
+        bool explain = false;
+        size_t rowCount = table.getRowCount();
+        for (size_t i = start; i < args.size(); i++) {
+            const std::string &option = args[i];
+            if (option == "--rows" && i + 1 < args.size()) {
+                std::vector<size_t> rows;
+                for (const auto& range : split(args[++i], ',')) {
+                    size_t dash = range.find('-');
+                    size_t from, to;
+                    bool valid = dash == std::string::npos
+                        ? parseUnsigned(range, from) && (to = from, true)
+                        : parseUnsigned(range.substr(0, dash), from) && parseUnsigned(range.substr(dash + 1), to);
+                    if (!valid || from == 0 || to < from) {
+                        throw std::runtime_error("Invalid row range: " + range);
+                    }
+                    for (size_t row = from; row <= std::min(to, rowCount); row++) {
+                        rows.push_back(row - 1);
+                    }
+                }
+                std::sort(rows.begin(), rows.end());
+                rows.erase(std::unique(rows.begin(), rows.end()), rows.end());
+                restrictSelection(sel, rows);
+            } else if (option == "--where" && i + 3 < args.size()) {
+                predicates.push_back(parsePredicate(args, i + 1));
+                i += 3;
+                // Further conditions follow as: and <col> <op> <value>
+                while (i + 4 < args.size() && toLower(args[i + 1]) == "and") {
+                    predicates.push_back(parsePredicate(args, i + 2));
+                    i += 4;
+                }
+            } else if (option == "--cols" && i + 1 < args.size()) {
+                sel.columns = split(args[++i], ',');
+            } else if (option == "--explain") {
+                explain = true;
+            } else {
+                throw std::runtime_error("Invalid view option: " + option +
+                                         " (use --rows <list>, --where <column> <op> <value>, --cols <list> or --explain)");
+            }
+        }
+        if (!predicates.empty()) {
+            std::vector<size_t> rows = table.filterRows(predicates, sel.allRows ? nullptr : &sel.rows);
+            sel.allRows = false;
+            sel.rows.swap(rows);
+        }
+        if (explain) {
+            printFilterPlan(predicates);
+        }
+        return sel;
+    }
+    
+    // Shows rows of a saved table without loading it, through its row index
+    void peekFile(const std::string &filename, const std::string &rowText, const std::string &countText) {
+        size_t row, count;
+        if (!parseUnsigned(rowText, row) || row == 0) {
+            throw std::runtime_error("Invalid row number: " + rowText);
+        }
+        if (!parseUnsigned(countText, count) || count == 0) {
+            throw std::runtime_error("Invalid row count: " + countText);
+        }
+        std::string path = resolveTableFile(filename);
+        size_t totalRows;
+        Table window = Table::loadRowWindow(path, row - 1, count, totalRows);
+        if (window.getRowCount() == 0) {
+            std::cout << "'" << path << "' has only " << totalRows << " row(s)." << std::endl;
+            return;
+        }
+        window.displayASCII(Selection(), row);
+        std::cout << "Rows " << row << "-" << row + window.getRowCount() - 1 << " of " << totalRows
+                  << " in '" << path << "'." << std::endl;
+    }
+    
+    // Scans a data directory for .odt files and reads only their headers.
+    // Tables listed in the catalog are loaded when first selected.
+    void openCatalog(const std::string &directory) {
+        std::error_code error;
+        std::vector<std::filesystem::path> paths;
+        for (const auto& item : std::filesystem::directory_iterator(directory, error)) {
+            if (item.is_regular_file() && item.path().extension() == ".odt") {
+                paths.push_back(item.path());
+            }
+        }
+        if (error) {
+            throw std::runtime_error("Cannot read directory: " + directory);
+        }
+        std::sort(paths.begin(), paths.end());
+        
+        std::vector<CatalogEntry> entries(paths.size());
+        std::vector<std::string> errors(paths.size());
+        parallelFor(paths.size(), [&](size_t i) {
+            try {
+                entries[i] = readCatalogEntry(paths[i]);
+            } catch (const std::exception &e) {
+                errors[i] = paths[i].string() + ": " + e.what();
+            }
+        });
+        
+        dataDirectory = directory;
+        catalog.clear();
+        for (size_t i = 0; i < paths.size(); i++) {
+            if (!errors[i].empty()) {
+                std::cout << "Skipped " << errors[i] << std::endl;
+            } else if (catalog.count(entries[i].name)) {
+                std::cout << "Skipped " << entries[i].path << ": table '" << entries[i].name
+                          << "' is already in " << catalog[entries[i].name].path << std::endl;
+            } else {
+                catalog[entries[i].name] = entries[i];
+            }
+        }
+        std::cout << "Catalog of '" << directory << "': " << catalog.size() << " table(s)." << std::endl;
+    }
+    
+    void selectTable(const std::string &tableName) {
+        std::unique_lock<std::mutex> lock(tablesMutex);
+        auto it = tables.find(tableName);
+        if (it == tables.end()) {
+            lock.unlock();
+            auto entry = catalog.find(tableName);
+            if (entry == catalog.end()) {
+                throw std::runtime_error("Table not found: " + tableName);
+            }
+            // Lazily open a catalogued table on first use
+            loadTable(entry->second.path);
+            lock.lock();
+            it = tables.find(tableName);
+            if (it == tables.end()) {
+                throw std::runtime_error("Table not found in " + entry->second.path + ": " + tableName);
+            }
+        }
+        
+        currentTable = it->second;
+        lock.unlock();
+        std::cout << "Selected table: " << tableName << std::endl;
+    }
+    
+    // Shows the current table, restricted by view options
+    void displayCurrentTable(const std::vector<std::string> &options = std::vector<std::string>()) {
+        std::shared_ptr<Table> table = current();
+        Selection sel = parseSelection(*table, options, 0);
+        table->displayASCII(sel);
+        if (!sel.allRows) {
+            std::cout << sel.rows.size() << " of " << table->getRowCount() << " row(s)." << std::endl;
+        }
+    }
+    
+    void editCell(const std::string &cellRef, const std::string &newValue) {
+        std::shared_ptr<Table> table = writableCurrent();
+        // Parse cell reference (e.g., "Name5" or "A5")
+        size_t i = 0;
+        while (i < cellRef.length() && !isdigit(cellRef[i])) ++i;
+        if (i == 0 || i == cellRef.length()) {
+            throw std::runtime_error("Invalid cell reference: " + cellRef);
+        }
+        std::string colName = cellRef.substr(0, i);
+        std::string rowStr = cellRef.substr(i);
+        size_t rowNumber;
+        if (!parseUnsigned(rowStr, rowNumber) || rowNumber == 0) {
+            throw std::runtime_error("Invalid row number: " + rowStr);
+        }
+        size_t rowIndex = rowNumber - 1; // Convert to 0-based index
+        // Check if column exists
+        auto colNames = table->getColumnNames();
+        if (std::find(colNames.begin(), colNames.end(), colName) == colNames.end()) {
+            throw std::runtime_error("Column not found: " + colName);
+        }
+        // Automatically expand rows if needed; new cells start out NULL
+        if (rowIndex >= table->getRowCount()) {
+            table->addNullRows(rowIndex + 1 - table->getRowCount());
+        }
+        table->setCell(colName, rowIndex, newValue);
+        std::cout << "Cell " << cellRef << " updated to: " << newValue << std::endl;
+    }
+    
+    void setColumnType(const std::string &colName, const std::string &typeName) {
+        std::shared_ptr<Table> table = writableCurrent();
+        ColumnType type;
+        if (!parseColumnType(typeName, type)) {
+            throw std::runtime_error("Unknown column type: " + typeName + " (use text, number or date)");
+        }
+        table->setColumnType(colName, type);
+        std::cout << "Column '" << colName << "' is now of type " << columnTypeName(type) << "." << std::endl;
+    }
+    
+    // Counts rows whose value compares true against a constant
+    void countMatches(const std::string &colName, const std::string &opText, const std::string &value) {
+        std::shared_ptr<Table> table = current();
+        findColumn(*table, colName);
+        std::vector<std::string> args = {colName, opText, value};
+        std::vector<Predicate> predicates(1, parsePredicate(args, 0));
+        std::vector<size_t> rows = table->filterRows(predicates, nullptr);
+        std::cout << rows.size() << " row(s) with " << colName << " " << opText << " " << value << "." << std::endl;
+    }
+    
+    // Prints value count, NULLs, distinct values, minimum, maximum and, for
+    // number columns, sum and average
+    void showColumnStats(const std::string &colName) {
+        std::shared_ptr<Table> table = current();
+        const Column &col = findColumn(*table, colName);
+        Aggregate agg = col.aggregate();
+        std::vector<uint64_t> hashes;
+        col.hash(hashes);
+        std::unordered_set<uint64_t> distinct;
+        for (size_t i = 0; i < hashes.size(); i++) {
+            if (!col.isNull(i)) distinct.insert(hashes[i]);
+        }
+        std::cout << "Column: " << colName << " (" << columnTypeName(col.getType()) << ")" << std::endl;
+        std::cout << "  Values:   " << agg.count << std::endl;
+        std::cout << "  NULLs:    " << col.nullCount() << std::endl;
+        std::cout << "  Distinct: " << distinct.size() << std::endl;
+        if (col.crackedPieces() > 0) {
+            std::cout << "  Cracked:  " << col.crackedPieces() << " piece(s)" << std::endl;
+        }
+        if (colName == table->getClusterKey()) {
+            std::cout << "  Cluster:  key, " << table->clusterTailRows() << " row(s) in unsorted tail" << std::endl;
+        }
+        if (agg.count == 0) return;
+        std::cout << "  Min:      " << Cell(agg.min, col.getType()).getValue() << std::endl;
+        std::cout << "  Max:      " << Cell(agg.max, col.getType()).getValue() << std::endl;
+        if (col.getType() == TYPE_NUMBER) {
+            char text[NUMBER_TEXT_SIZE];
+            std::cout << "  Sum:      " << std::string(text, formatNumber(agg.sum, text)) << std::endl;
+            double mean = agg.sum / static_cast<double>(agg.count);
+            std::cout << "  Average:  " << std::string(text, formatNumber(mean, text)) << std::endl;
+        }
+    }
+    
+    // Counts rows whose date lies between two dates, inclusive
+    void countDateRange(const std::string &colName, const std::string &from, const std::string &to) {
+        std::shared_ptr<Table> table = current();
+        const Column &col = dateColumn(*table, colName);
+        int64_t lo, hi;
+        if (!parseTimestamp(from.data(), from.data() + from.size(), lo) ||
+            !parseTimestamp(to.data(), to.data() + to.size(), hi)) {
+            throw std::runtime_error("Invalid date range: " + from + " " + to);
+        }
+        // A bare end date includes its whole day
+        if (to.size() <= 10) hi += 86399;
+        std::cout << col.countInRange(lo, hi) << " row(s) with " << colName
+                  << " between " << from << " and " << to << "." << std::endl;
+    }
+    
+    // Prints the number of rows per day, month, hour or minute
+    void countByDate(const std::string &colName, const std::string &unitName) {
+        std::shared_ptr<Table> table = current();
+        const Column &col = dateColumn(*table, colName);
+        TimeUnit unit;
+        if (!parseTimeUnit(unitName, unit)) {
+            throw std::runtime_error("Unknown time unit: " + unitName + " (use minute, hour, day or month)");
+        }
+        std::map<int64_t, size_t> counts = col.countByBucket(unit);
+        for (const auto& pair : counts) {
+            std::cout << "  " << bucketLabel(pair.first, unit) << "  " << pair.second << std::endl;
+        }
+        if (col.nullCount() > 0) {
+            std::cout << "  (null)  " << col.nullCount() << std::endl;
+        }
+    }
+    
+    void addRow(const std::vector<std::string> &values) {
+        std::shared_ptr<Table> table = writableCurrent();
+        table->addRow(values);
+        std::cout << "Row added successfully." << std::endl;
+    }
+    
+    void listTables() {
+        std::vector<std::shared_ptr<Table>> handles = tableHandles();
+        if (handles.empty()) {
+            std::cout << "No tables loaded." << std::endl;
+        } else {
+            std::cout << "Available tables:" << std::endl;
+            for (const auto& table : handles) {
+                std::cout << "  " << table->getName();
+                for (const auto& reload : reloads) {
+                    if (!reload->done && reload->table == table->getName()) std::cout << " (reloading)";
+                }
+                std::cout << std::endl;
+            }
+        }
+        if (!dataDirectory.empty()) {
+            listCatalog();
+        }
+    }
+    
+    // Prints the catalogued tables with their header metadata
+    void listCatalog() {
+        std::cout << "Catalog of '" << dataDirectory << "':" << std::endl;
+        if (catalog.empty()) {
+            std::cout << "  (no tables)" << std::endl;
+            return;
+        }
+        size_t nameWidth = 0;
+        for (const auto& pair : catalog) nameWidth = std::max(nameWidth, pair.first.size());
+        for (const auto& pair : catalog) {
+            const CatalogEntry &entry = pair.second;
+            char modified[32];
+            std::tm local = *std::localtime(&entry.modified);
+            std::strftime(modified, sizeof(modified), "%Y-%m-%d %H:%M", &local);
+            std::cout << "  " << std::setw(nameWidth) << std::left << entry.name << "  "
+                      << entry.rowCount << " rows, " << entry.columns.size() << " columns, "
+                      << std::fixed << std::setprecision(1) << entry.bytes / (1024.0 * 1024.0) << " MB, "
+                      << modified << ", " << std::filesystem::path(entry.path).filename().string();
+            std::cout.unsetf(std::ios::floatfield);
+            std::cout << std::setprecision(6);
+            if (entry.indexed) std::cout << ", row index";
+            if (findLoaded(entry.name)) std::cout << ", loaded";
+            std::cout << std::endl;
+            std::cout << "  " << std::string(nameWidth, ' ') << "  ";
+            for (size_t j = 0; j < entry.columns.size(); j++) {
+                if (j > 0) std::cout << ", ";
+                std::cout << entry.columns[j] << ":" << columnTypeName(entry.types[j]);
+            }
+            std::cout << std::endl;
+        }
+    }
+    
+    bool hasCurrentTable() const {
+        std::lock_guard<std::mutex> lock(tablesMutex);
+        return currentTable != nullptr;
+    }
+    
+    std::string getCurrentTableName() const {
+        std::lock_guard<std::mutex> lock(tablesMutex);
+        return currentTable ? currentTable->getName() : "";
+    }
+};
+
+// Utility function implementations
+std::vector<std::string> split(const std::string &s, char delimiter) {
+    std::vector<std::string> tokens;
+    std::string token;
+    std::istringstream tokenStream(s);
+    while (std::getline(tokenStream, token, delimiter)) {
+        tokens.push_back(trim(token));
+    }
+    return tokens;
+}
+
+// Splits a line into trimmed fields, reusing the strings in fields. Unlike
+// split, a trailing empty field is kept, so "a," yields two fields.
+void splitFields(const char* begin, const char* end, char delimiter, std::vector<std::string> &fields) {
+    size_t count = 0;
+    const char* fieldStart = begin;
+    while (true) {
+        const char* fieldEnd = static_cast<const char*>(std::memchr(fieldStart, delimiter, end - fieldStart));
+        if (!fieldEnd) fieldEnd = end;
+        const char* b = fieldStart;
+        const char* e = fieldEnd;
+        while (b < e && std::isspace(static_cast<unsigned char>(*b))) ++b;
+        while (e > b && std::isspace(static_cast<unsigned char>(e[-1]))) --e;
+        if (count == fields.size()) fields.emplace_back();
+        fields[count++].assign(b, e);
+        if (fieldEnd == end) break;
+        fieldStart = fieldEnd + 1;
+    }
+    fields.resize(count);
+}
+
+std::string trim(const std::string &s) {
+    size_t start = s.find_first_not_of(" \t\n\r\f\v");
+    size_t end = s.find_last_not_of(" \t\n\r\f\v");
+    return (start == std::string::npos) ? "" : s.substr(start, end - start + 1);
+}
+
+std::string toLower(const std::string &s) {
+    std::string result = s;
+    std::transform(result.begin(), result.end(), result.begin(), ::tolower);
+    return result;
+}
+
+bool isNumber(const std::string &s) {
+    if (s.empty()) return false;
+    for (char c : s) {
+        if (!isdigit(c)) return false;
+    }
+    return true;
+}
+
+// Strict decimal parse of a non-negative integer that fits in size_t
+bool parseUnsigned(const std::string &s, size_t &value) {
+    if (s.empty()) return false;
+    const char* end = s.data() + s.size();
+    std::from_chars_result result = std::from_chars(s.data(), end, value);
+    return result.ec == std::errc() && result.ptr == end;
+}
+
+// Locale-independent parse of a whole field as a floating-point number
+bool parseNumber(const char* begin, const char* end, double &value) {
+    if (begin < end && *begin == '+') ++begin;
+    if (begin == end) return false;
+    std::from_chars_result result = std::from_chars(begin, end, value);
+    return result.ec == std::errc() && result.ptr == end;
+}
+
+// Writes the shortest text that reads back as value; out must have room
+// for NUMBER_TEXT_SIZE bytes
+size_t formatNumber(double value, char* out) {
+    std::to_chars_result result = std::to_chars(out, out + NUMBER_TEXT_SIZE, value);
+    return static_cast<size_t>(result.ptr - out);
+}
+
+void appendUnsigned(std::string &out, uint64_t value) {
+    char buffer[24];
+    std::to_chars_result result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    out.append(buffer, result.ptr);
+}
+
+// Days since 1970-01-01 of a proleptic Gregorian date
+int64_t daysFromCivil(int64_t year, unsigned month, unsigned day) {
+    year -= month <= 2;
+    int64_t era = floorDiv(year, 400);
+    unsigned yearOfEra = static_cast<unsigned>(year - era * 400);
+    unsigned dayOfYear = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    unsigned dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + static_cast<int64_t>(dayOfEra) - 719468;
+}
+
+void civilFromDays(int64_t days, int64_t &year, unsigned &month, unsigned &day) {
+    days += 719468;
+    int64_t era = floorDiv(days, 146097);
+    unsigned dayOfEra = static_cast<unsigned>(days - era * 146097);
+    unsigned yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    unsigned dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    unsigned mp = (5 * dayOfYear + 2) / 153;
+    day = dayOfYear - (153 * mp + 2) / 5 + 1;
+    month = mp < 10 ? mp + 3 : mp - 9;
+    year = static_cast<int64_t>(yearOfEra) + era * 400 + (month <= 2);
+}
+
+// Reads count digits at p; returns false if any is not a digit
+static inline bool readDigits(const char* p, int count, unsigned &value) {
+    value = 0;
+    for (int i = 0; i < count; i++) {
+        unsigned digit = static_cast<unsigned>(p[i] - '0');
+        if (digit > 9) return false;
+        value = value * 10 + digit;
+    }
+    return true;
+}
+
+// Fixed-position parser for the date formats RowDB accepts:
+//   YYYY-MM-DD, YYYY/MM/DD or DD.MM.YYYY, optionally followed by a space or
+//   'T' and HH:MM or HH:MM:SS, and an optional trailing 'Z'
+bool parseTimestamp(const char* begin, const char* end, int64_t &value) {
+    size_t length = static_cast<size_t>(end - begin);
+    if (length > 0 && end[-1] == 'Z') --length;
+    if (length < 10) return false;
+    unsigned year, month, day;
+    if ((begin[4] == '-' || begin[4] == '/') && begin[7] == begin[4]) {
+        if (!readDigits(begin, 4, year) || !readDigits(begin + 5, 2, month) ||
+            !readDigits(begin + 8, 2, day)) return false;
+    } else if (begin[2] == '.' && begin[5] == '.') {
+        if (!readDigits(begin, 2, day) || !readDigits(begin + 3, 2, month) ||
+            !readDigits(begin + 6, 4, year)) return false;
+    } else {
+        return false;
+    }
+    static const unsigned monthDays[] = {31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    if (month < 1 || month > 12 || day < 1 || day > monthDays[month - 1]) return false;
+    if (month == 2 && day == 29 && !(year % 4 == 0 && (year % 100 != 0 || year % 400 == 0))) return false;
+    
+    unsigned hour = 0, minute = 0, second = 0;
+    if (length > 10) {
+        if ((begin[10] != ' ' && begin[10] != 'T') || (length != 16 && length != 19)) return false;
+        if (!readDigits(begin + 11, 2, hour) || begin[13] != ':' || !readDigits(begin + 14, 2, minute)) return false;
+        if (length == 19 && (begin[16] != ':' || !readDigits(begin + 17, 2, second))) return false;
+        if (hour > 23 || minute > 59 || second > 59) return false;
+    }
+    value = daysFromCivil(year, month, day) * 86400 + hour * 3600 + minute * 60 + second;
+    return true;
+}
+
+static inline char* writeDigits(char* out, unsigned value, int count) {
+    for (int i = count - 1; i >= 0; i--) {
+        out[i] = static_cast<char>('0' + value % 10);
+        value /= 10;
+    }
+    return out + count;
+}
+
+// Formats a timestamp as YYYY-MM-DD, or YYYY-MM-DD HH:MM:SS when it is not
+// at midnight; out must have room for NUMBER_TEXT_SIZE bytes
+size_t formatTimestamp(int64_t value, char* out) {
+    int64_t days = floorDiv(value, 86400);
+    unsigned seconds = static_cast<unsigned>(value - days * 86400);
+    int64_t year;
+    unsigned month, day;
+    civilFromDays(days, year, month, day);
+    char* p = out;
+    if (year < 0 || year > 9999) {
+        p = std::to_chars(p, out + 12, year).ptr;
+    } else {
+        p = writeDigits(p, static_cast<unsigned>(year), 4);
+    }
+    *p++ = '-';
+    p = writeDigits(p, month, 2);
+    *p++ = '-';
+    p = writeDigits(p, day, 2);
+    if (seconds != 0) {
+        *p++ = ' ';
+        p = writeDigits(p, seconds / 3600, 2);
+        *p++ = ':';
+        p = writeDigits(p, seconds / 60 % 60, 2);
+        *p++ = ':';
+        p = writeDigits(p, seconds % 60, 2);
+    }
+    return static_cast<size_t>(p - out);
+}
+
+bool fileExists(const std::string &filename) {
+    std::ifstream file(filename);
+    return file.good();
+}
+
+// Expands a glob pattern into the sorted list of matching files. Patterns
+// without matches (and plain filenames) are returned unchanged.
+std::vector<std::string> expandPattern(const std::string &pattern) {
+    std::vector<std::string> matches;
+#ifndef _WIN32
+    if (pattern.find_first_of("*?[") != std::string::npos) {
+        glob_t results;
+        if (glob(pattern.c_str(), 0, nullptr, &results) == 0) {
+            for (size_t i = 0; i < results.gl_pathc; i++) {
+                matches.push_back(results.gl_pathv[i]);
+            }
+        }
+        globfree(&results);
+    }
+#endif
+    if (matches.empty()) {
+        matches.push_back(pattern);
+    }
+    return matches;
+}
+
+// Number of worker threads to use for the given number of independent tasks
+size_t workerCount(size_t tasks) {
+    size_t hardware = std::thread::hardware_concurrency();
+    if (hardware == 0) hardware = 1;
+    return std::max<size_t>(1, std::min(hardware, tasks));
+}
+
+// Runs body(0) .. body(count - 1) on a pool of worker threads. Each index is
+// handed out at most once; after the first exception no new indices are
+// started, and it is rethrown once all workers have stopped.
+void parallelFor(size_t count, const std::function<void(size_t)> &body) {
+    size_t workers = workerCount(count);
+    if (workers <= 1) {
+        for (size_t i = 0; i < count; i++) body(i);
+        return;
+    }
+    std::atomic<size_t> next(0);
+    std::exception_ptr failure;
+    std::mutex failureMutex;
+    auto fail = [&]() {
+        std::lock_guard<std::mutex> lock(failureMutex);
+        if (!failure) failure = std::current_exception();
+        next = count;
+    };
+    auto worker = [&]() {
+        try {
+            for (size_t i = next++; i < count; i = next++) body(i);
+        } catch (...) {
+            fail();
+        }
+    };
+    std::vector<std::thread> threads;
+    try {
+        for (size_t t = 1; t < workers; t++) {
+            threads.emplace_back(worker);
+        }
+    } catch (...) {
+        fail();
+    }
+    worker();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    if (failure) std::rethrow_exception(failure);
+}
+
+// Creates filename with exactly size bytes and lets fill write them in place
+void writeFileWith(const std::string &filename, size_t size, const std::function<void(char*)> &fill) {
+#ifndef _WIN32
+    int fd = open(filename.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open file for writing: " + filename);
+    }
+    if (size == 0) {
+        close(fd);
+        return;
+    }
+    if (ftruncate(fd, static_cast<off_t>(size)) == 0) {
+        void* mem = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (mem != MAP_FAILED) {
+            close(fd);
+            fill(static_cast<char*>(mem));
+            munmap(mem, size);
+            return;
+        }
+    }
+    close(fd);
+#endif
+    std::vector<char> buffer(size);
+    fill(buffer.data());
+    std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        throw std::runtime_error("Cannot open file for writing: " + filename);
+    }
+    file.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    if (!file) {
+        throw std::runtime_error("Cannot write file: " + filename);
+    }
+}
+
+// Draws count distinct row numbers below total uniformly at random and
+// returns them ascending. For small samples Floyd's algorithm takes one
+// random number per sampled row, so the work depends only on count.
+std::vector<size_t> sampleRowNumbers(size_t total, size_t count, uint64_t seed) {
+    std::vector<size_t> chosen;
+    if (count >= total) {
+        chosen.resize(total);
+        for (size_t i = 0; i < total; i++) chosen[i] = i;
+        return chosen;
+    }
+    std::mt19937_64 random(seed);
+    // Large samples are cheaper as one pass that keeps each row with
+    // probability wanted / remaining
+    if (count > total / 8) {
+        std::uniform_real_distribution<double> unit(0, 1);
+        for (size_t i = 0; i < total && chosen.size() < count; i++) {
+            if (unit(random) * static_cast<double>(total - i) < static_cast<double>(count - chosen.size())) {
+                chosen.push_back(i);
+            }
+        }
+        return chosen;
+    }
+    std::unordered_set<size_t> taken;
+    taken.reserve(count);
+    for (size_t j = total - count; j < total; j++) {
+        size_t pick = std::uniform_int_distribution<size_t>(0, j)(random);
+        taken.insert(taken.count(pick) ? j : pick);
+    }
+    chosen.assign(taken.begin(), taken.end());
+    std::sort(chosen.begin(), chosen.end());
+    return chosen;
+}
+
+// Main function and command processing
+void showHelp() {
+    std::cout << SOFTWARE_NAME << " - Personal Data Table Manager" << std::endl;
+    std::cout << "Usage:" << std::endl;
+    std::cout << "  " << SOFTWARE_NAME << " [options]" << std::endl;
+    std::cout << "Options:" << std::endl;
+    std::cout << "  -c, --create <table> [columns...]  Create a new table" << std::endl;
+    std::cout << "  -e, --edit <cellRef> <value>       Edit a cell (e.g., A5)" << std::endl;
+    std::cout << "  -t, --type <column> <type>         Set a column type: text, number, date" << std::endl;
+    std::cout << "  -v, --view [options]               View current table" << std::endl;
+    std::cout << "  --count <column> <op> <value>      Count rows matching =, !=, <, <=, >, >=, like" << std::endl;
+    std::cout << "  --stats <column>                   Show column statistics" << std::endl;
+    std::cout << "  --between <column> <from> <to>     Count rows in a date range" << std::endl;
+    std::cout << "  --count-by <column> <unit>         Count rows per minute/hour/day/month" << std::endl;
+    std::cout << "  --resample <col> <[n]unit> [agg(<col>)...] [fill]" << std::endl;
+    std::cout << "                                     Aggregate rows per minute/hour/day/month bucket" << std::endl;
+    std::cout << "  --pivot rows=<col> cols=<col> [value=agg(<col>)]" << std::endl;
+    std::cout << "                                     Crosstab with count, sum, avg, min or max per cell" << std::endl;
+    std::cout << "  --sample <n|p%> [file]             Random sample of the current table or a saved file" << std::endl;
+    std::cout << "  --window <column> <function> [by <col>] [order <col> [desc]]" << std::endl;
+    std::cout << "                                     Add a row_number, rank, cumsum(col) or moving_avg(col,n) column" << std::endl;
+    std::cout << "  -s, --select <table>               Select a table" << std::endl;
+    std::cout << "  -l, --load <file> [files...]       Load tables from files (globs allowed)" << std::endl;
+    std::cout << "  --reload <table>                   Re-read a table from its file in the background" << std::endl;
+    std::cout << "  --cluster <table> on <col> | off   Keep a table sorted by a key column" << std::endl;
+    std::cout << "  sql [explain] select ...           Run a SQL query (see README for the supported subset)" << std::endl;
+    std::cout << "  --join <table>                     Merge-join the current table with another on their cluster keys" << std::endl;
+    std::cout << "  -sv, --save <file> [options]       Save current table to file (--index adds a row index)" << std::endl;
+    std::cout << "  --peek <file> <row> [count]        Show rows of a saved file via its row index" << std::endl;
+    std::cout << "  --list                             List loaded and catalogued tables" << std::endl;
+    std::cout << "  --catalog <dir>                    Catalog the tables in a directory" << std::endl;
+    std::cout << "  --publish <table>                  Share a table via shared memory" << std::endl;
+    std::cout << "  --attach <table>                   Attach to a published table" << std::endl;
+    std::cout << "  --unpublish <table>                Remove a published table" << std::endl;
+    std::cout << "  --snapshot <file>                  Save all loaded tables to one image" << std::endl;
+    std::cout << "  --restore <file>                   Restore tables from a snapshot" << std::endl;
+    std::cout << "  --numa <off|interleave|node>       Place large column buffers on NUMA nodes" << std::endl;
+    std::cout << "  --cracking <on|off>                Index filtered columns adaptively" << std::endl;
+    std::cout << "  --help                             Show this help message" << std::endl;
+    std::cout << "  --version                          Show version information" << std::endl;
+    std::cout << std::endl;
+    std::cout << "View and save options:" << std::endl;
+    std::cout << "  --rows <list>                      Rows and ranges, e.g. 10,500-900" << std::endl;
+    std::cout << "  --where <column> <op> <value>      Rows whose value matches; chain with 'and'" << std::endl;
+    std::cout << "  --explain                          Print the order filter conditions ran in" << std::endl;
+    std::cout << "  --cols <list>                      Columns to include, e.g. name,age" << std::endl;
+    std::cout << std::endl;
+    std::cout << "Supported Formats:" << std::endl;
+    std::cout << "  .odt - Open Data Table (unencrypted)" << std::endl;
+}
+
+void showVersion() {
+    std::cout << SOFTWARE_NAME << " version " << VERSION << std::endl;
+}
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+int main(int argc, char* argv[]) {
+#ifdef _WIN32
+    SetConsoleTitleA(SOFTWARE_NAME);
+#endif
+    DatabaseManager dbManager;
+    
+    // If no arguments, start interactive mode
+    if (argc == 1) {
+        std::cout << SOFTWARE_NAME << " " << VERSION << std::endl;
+        std::cout << "Type 'help' for commands or 'exit' to quit." << std::endl;
+        
+        std::string input;
+        while (true) {
+            dbManager.finishReloads();
+            if (dbManager.hasCurrentTable()) {
+                std::cout << SOFTWARE_NAME << "/" << dbManager.getCurrentTableName() << " >> ";
+            } else {
+                std::cout << SOFTWARE_NAME << " >> ";
+            }
+            
+            std::getline(std::cin, input);
+            if (input.empty()) continue;
+            
+            std::vector<std::string> args = split(input, ' ');
+            std::string command = toLower(args[0]);
+            
+            if (command == "exit" || command == "quit") {
+                break;
+            } else if (command == "help") {
+                showHelp();
+            } else if (command == "version") {
+                showVersion();
+            } else if (command == "-c" || command == "--create") {
+                if (args.size() < 3) {
+                    std::cout << "Error: Table name and at least one column required." << std::endl;
+                    continue;
+                }
+                
+                std::string tableName = args[1];
+                std::vector<std::string> columns(args.begin() + 2, args.end());
+                dbManager.createTable(tableName, columns);
+            } else if (command == "-e" || command == "--edit") {
+                if (args.size() < 3) {
+                    std::cout << "Error: Cell reference and value required." << std::endl;
+                    continue;
+                }
+                
+                std::string cellRef = args[1];
+                std::string value = args[2];
+                for (size_t i = 3; i < args.size(); i++) {
+                    value += " " + args[i];
+                }
+                
+                try {
+                    dbManager.editCell(cellRef, value);
+                } catch (const std::exception &e) {
+                    std::cout << "Error: " << e.what() << std::endl;
+                }
+            } else if (command == "-t" || command == "--type") {
+                if (args.size() < 3) {
+                    std::cout << "Error: Column name and type required." << std::endl;
+                    continue;
+                }
+                try {
+                    dbManager.setColumnType(args[1], toLower(args[2]));
+                } catch (const std::exception &e) {
+                    std::cout << "Error: " << e.what() << std::endl;
+                }
+            } else if (command == "--count") {
+                if (args.size() < 4) {
+                    std::cout << "Error: Column name, operator and value required." << std::endl;
+                    continue;
+                }
+                try {
+                    dbManager.countMatches(args[1], args[2], args[3]);
+                } catch (const std::exception &e) {
+                    std::cout << "Error: " << e.what() << std::endl;
+                }
+            } else if (command == "--stats") {
+                if (args.size() < 2) {
+                    std::cout << "Error: Column name required." << std::endl;
+                    continue;
+                }
+                try {
+                    dbManager.showColumnStats(args[1]);
+                } catch (const std::exception &e) {
+                    std::cout << "Error: " << e.what() << std::endl;
+                }
+            } else if (command == "--between") {
+                if (args.size() < 4) {
+                    std::cout << "Error: Column name and two dates required." << std::endl;
+                    continue;
+                }
+                try {
+                    dbManager.countDateRange(args[1], args[2], args[3]);
+                } catch (const std::exception &e) {
+                    std::cout << "Error: " << e.what() << std::endl;
+                }
+            } else if (command == "--count-by") {
+                if (args.size() < 3) {
+                    std::cout << "Error: Column name and time unit required." << std::endl;
+                    continue;
+                }
+                try {
+                    dbManager.countByDate(args[1], toLower(args[2]));
+                } catch (const std::exception &e) {
+                    std::cout << "Error: " << e.what() << std::endl;
+                }
+            } else if (command == "-v" || command == "--view") {
+                try {
+                    dbManager.displayCurrentTable(std::vector<std::string>(args.begin() + 1, args.end()));
+                } catch (const std::exception &e) {
+                    std::cout << "Error: " << e.what() << std::endl;
+                }
+            } else if (command == "-s" || command == "--select") {
+                if (args.size() < 2) {
+                    std::cout << "Error: Table name required." << std::endl;
+                    continue;
+                }
+                
+                std::string tableName = args[1];
+                try {
+                    dbManager.selectTable(tableName);
+                } catch (const std::exception &e) {
+                    std::cout << "Error: " << e.what() << std::endl;
+                }
+            } else if (command == "-l" || command == "--load") {
+                if (args.size() < 2) {
+                    std::cout << "Error: Filename required." << std::endl;
+                    continue;
+                }
+                std::vector<std::string> filenames(args.begin() + 1, args.end());
+                try {
+                    dbManager.loadTables(filenames);
+                } catch (const std::exception &e) {
+                    std::cout << "Error: " << e.what() << std::endl;
+                }
+            } else if (command == "-sv" || command == "--save") {
+                if (args.size() < 2) {
+                    std::cout << "Error: Filename required." << std::endl;
+                    continue;
+                }
+                std::string filename = args[1];
+                try {
+                    dbManager.saveTable(filename, std::vector<std::string>(args.begin() + 2, args.end()));
+                } catch (const std::exception &e) {
+                    std::cout << "Error: " << e.what() << std::endl;
+                }
+            } else if (command == "--peek") {
+                if (args.size() < 3) {
+                    std::cout << "Error: Filename and row number required." << std::endl;
+                    continue;
+                }
+                try {
+                    dbManager.peekFile(args[1], args[2], args.size() > 3 ? args[3] : "20");
+                } catch (const std::exception &e) {
+                    std::cout << "Error: " << e.what() << std::endl;
+                }
+            } else if (command == "--resample") {
+                if (args.size() < 3) {
+                    std::cout << "Error: Date column and interval required." << std::endl;
+                    continue;
+                }
+                try {
+                    dbManager.resampleTable(std::vector<std::string>(args.begin() + 1, args.end()));
+                } catch (const std::exception &e) {
+                    std::cout << "Error: " << e.what() << std::endl;
+                }
+            } else if (command == "--pivot") {
+                if (args.size() < 3) {
+                    std::cout << "Error: rows=<col> and cols=<col> required." << std::endl;
+                    continue;
+                }
+                try {
+                    dbManager.pivotTable(std::vector<std::string>(args.begin() + 1, args.end()));
+                } catch (const std::exception &e) {
+                    std::cout << "Error: " << e.what() << std::endl;
+                }
+            } else if (command == "--sample") {
+                if (args.size() < 2) {
+                    std::cout << "Error: Sample size required." << std::endl;
+                    continue;
+                }
+                try {
+                    dbManager.sampleRows(args[1], args.size() > 2 ? args[2] : "");
+                } catch (const std::exception &e) {
+                    std::cout << "Error: " << e.what() << std::endl;
+                }
+            } else if (command == "--window") {
+                if (args.size() < 3) {
+                    std::cout << "Error: Column name and window function required." << std::endl;
+                    continue;
+                }
+                try {
+                    dbManager.addWindowColumn(std::vector<std::string>(args.begin() + 1, args.end()));
+                } catch (const std::exception &e) {
+                    std::cout << "Error: " << e.what() << std::endl;
+                }
+            } else if (command == "sql") {
+                if (args.size() < 2) {
+                    std::cout << "Error: SQL statement required." << std::endl;
+                    continue;
+                }
+                try {
+                    dbManager.runSql(input.substr(input.find(args[0]) + args[0].size()));
+                } catch (const std::exception &e) {
+                    std::cout << "Error: " << e.what() << std::endl;
+                }
+            } else if (command == "--cluster") {
+                if (args.size() < 3) {
+                    std::cout << "Error: Table name and 'on <column>' or 'off' required." << std::endl;
+                    continue;
+                }
+                try {
+                    dbManager.clusterTable(args[1], std::vector<std::string>(args.begin() + 2, args.end()));
+                } catch (const std::exception &e) {
+                    std::cout << "Error: " << e.what() << std::endl;
+                }
+            } else if (command == "--join") {
+                if (args.size() < 2) {
+                    std::cout << "Error: Table name required." << std::endl;
+                    continue;
+                }
+                try {
+                    dbManager.joinTables(args[1]);
+                } catch (const std::exception &e) {
+                    std::cout << "Error: " << e.what() << std::endl;
+                }
+            } else if (command == "--reload") {
+                if (args.size() < 2) {
+                    std::cout << "Error: Table name required." << std::endl;
+                    continue;
+                }
+                try {
+                    dbManager.reloadTable(args[1]);
+                } catch (const std::exception &e) {
+                    std::cout << "Error: " << e.what() << std::endl;
+                }
+            } else if (command == "--catalog") {
+                if (args.size() < 2) {
+                    std::cout << "Error: Directory required." << std::endl;
+                    continue;
+                }
+                try {
+                    dbManager.openCatalog(args[1]);
+                } catch (const std::exception &e) {
+                    std::cout << "Error: " << e.what() << std::endl;
+                }
+            } else if (command == "--list") {
+                dbManager.listTables();
+            } else if (command == "--numa") {
+                if (args.size() < 2) {
+                    std::cout << "Error: NUMA policy required." << std::endl;
+                    continue;
+                }
+                try {
+                    dbManager.setNumaPolicy(toLower(args[1]));
+                } catch (const std::exception &e) {
+                    std::cout << "Error: " << e.what() << std::endl;
+                }
+            } else if (command == "--cracking") {
+                if (args.size() < 2) {
+                    std::cout << "Error: Cracking mode required." << std::endl;
+                    continue;
+                }
+                try {
+                    dbManager.setCracking(toLower(args[1]));
+                } catch (const std::exception &e) {
+                    std::cout << "Error: " << e.what() << std::endl;
+                }
+            } else if (command == "--snapshot" || command == "--restore") {
+                if (args.size() < 2) {
+                    std::cout << "Error: Filename required." << std::endl;
+                    continue;
+                }
+                try {
+                    if (command == "--snapshot") {
+                        dbManager.saveSnapshot(args[1]);
+                    } else {
+                        dbManager.restoreSnapshot(args[1]);
+                    }
+                } catch (const std::exception &e) {
+                    std::cout << "Error: " << e.what() << std::endl;
+                }
+            } else if (command == "--publish" || command == "--attach" || command == "--unpublish") {
+                if (args.size() < 2) {
+                    std::cout << "Error: Table name required." << std::endl;
+                    continue;
+                }
+                try {
+                    if (command == "--publish") {
+                        dbManager.publishTable(args[1]);
+                    } else if (command == "--attach") {
+                        dbManager.attachTable(args[1]);
+                    } else {
+                        dbManager.unpublishTable(args[1]);
+                    }
+                } catch (const std::exception &e) {
+                    std::cout << "Error: " << e.what() << std::endl;
+                }
+            } else {
+                std::cout << "Unknown command: " << command << std::endl;
+                std::cout << "Type 'help' for available commands." << std::endl;
+            }
+        }
+    } else {
+        // Process command line arguments
+        std::vector<std::string> args;
+        for (int i = 1; i < argc; i++) {
+            args.push_back(argv[i]);
+        }
+        
+        std::string command = toLower(args[0]);
+        
+        if (command == "--help") {
+            showHelp();
+        } else if (command == "--version") {
+            showVersion();
+        } else {
+            std::cout << "For interactive mode, run without arguments." << std::endl;
+            std::cout << "Use --help for more information." << std::endl;
+        }
+    }
+    
+    return 0;
 }
\ No newline at end of file
@@ -0,0 +1,137 @@
+#!/bin/sh
+# Smoke test: drives the interactive app through a scripted session and
+# checks the output. Usage: tests/smoke.sh [path/to/app]
+# Without an argument app.cpp is compiled into a temporary directory first.
+
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+if [ -n "$1" ]; then
+    APP=$(cd "$(dirname "$1")" && pwd)/$(basename "$1")
+else
+    APP=$WORK/app
+    echo "Building $APP"
+    ${CXX:-g++} -std=c++17 -O2 -pthread -o "$APP" "$ROOT/app.cpp" || exit 1
+fi
+cd "$WORK" || exit 1
+
+cat > people.odt <<'E'
+TABLE:people
+COLUMNS:id,name,city,age
+TYPES:number,text,text,number
+ROWS:6
+DATA:
+1,ann,Berlin,34
+2,bob,Paris,27
+3,carolinexxxxxxxxxx,Berlin,41
+4,dan,Rome,
+5,eve,Paris,52
+6,fay,,19
+E
+cat > orders.odt <<'E'
+TABLE:orders
+COLUMNS:oid,pid,amount
+TYPES:number,number,number
+ROWS:5
+DATA:
+10,1,100
+11,3,250
+12,1,50
+13,5,75
+14,9,20
+E
+# 2000 rows with a value in every 500th row only
+awk 'BEGIN {
+    print "TABLE:sparse"; print "COLUMNS:n"; print "TYPES:number"; print "ROWS:2000"; print "DATA:"
+    for (i = 0; i < 2000; i++) print (i % 500 == 0 ? i : "")
+}' > sparse.odt
+
+OUT=$("$APP" <<'E' 2>&1
+-l people.odt orders.odt sparse.odt
+-s people
+--view --where age > 30 and city = Berlin --explain
+sql select p.city, count(*), sum(o.amount) from orders o join people p on o.pid = p.id group by p.city order by 3 desc
+sql explain select name from people where age < 30 order by name
+sql select name, age from people where city = 'Paris' order by age desc limit 1
+--cluster people on age
+--view --cols name,age
+-sv people_saved.odt --index
+--peek people_saved.odt 3 2
+--snapshot work.snap
+--restore work.snap
+-s sparse
+--stats n
+-s people
+--view --cols name,age --rows 1-3
+--reload people
+exit
+E
+)
+
+FAILURES=0
+expect() {
+    case "$OUT" in
+        *"$1"*) ;;
+        *) echo "FAIL: expected output:"; echo "$1"; FAILURES=$((FAILURES + 1)) ;;
+    esac
+}
+
+# --where with --explain
+expect "  1. age > 30       est. 50.0% pass, cost 1.0 -> 3 row(s)
+  2. city = Berlin  est. 66.7% pass, cost 2.0 -> 2 row(s)"
+expect "| 1 | 1  | ann                | Berlin | 34  |
+| 3 | 3  | carolinexxxxxxxxxx | Berlin | 41  |
++---+----+--------------------+--------+-----+
+2 of 6 row(s)."
+
+# sql: join, group by and order by, explain, limit
+expect "| # | p.city | count(*) | sum(o.amount) |
++---+--------+----------+---------------+
+| 1 | Berlin | 3        | 400           |
+| 2 | Paris  | 1        | 75            |
++---+--------+----------+---------------+"
+expect "Plan:
+  1. Scan people: 6 rows, where age < 30 -> 2 rows, reads name
+  2. Sort by name"
+expect "| 1 | eve  | 52  |
++---+------+-----+
+1 row(s) in"
+
+# --cluster keeps rows sorted on the key, NULLs first
+expect "Table 'people' clustered on 'age'"
+expect "| 1 | dan                |     |
+| 2 | fay                | 19  |
+| 3 | bob                | 27  |
+| 4 | ann                | 34  |
+| 5 | carolinexxxxxxxxxx | 41  |
+| 6 | eve                | 52  |"
+
+# --peek through the row index sidecar
+expect "| 3 | 2  | bob  | Paris  | 27  |
+| 4 | 1  | ann  | Berlin | 34  |
++---+----+------+--------+-----+
+Rows 3-4 of 6 in 'people_saved.odt'."
+
+# --snapshot/--restore, including a mostly-NULL table, the cluster order
+# and the source file used by --reload
+expect "Snapshot of 3 table(s) saved to 'work.snap'"
+expect "Restored 3 table(s) from 'work.snap'."
+expect "  Values:   4
+  NULLs:    1996"
+expect "  Sum:      3000"
+expect "| 1 | dan  |     |
+| 2 | fay  | 19  |
+| 3 | bob  | 27  |"
+expect "Reloading table 'people' from 'people.odt' in the background."
+
+case "$OUT" in
+    *"Error:"*) echo "FAIL: unexpected error:"; echo "$OUT" | grep "Error:"; FAILURES=$((FAILURES + 1)) ;;
+esac
+
+if [ "$FAILURES" -ne 0 ]; then
+    echo "$FAILURES check(s) failed. Full output:"
+    echo "$OUT"
+    exit 1
+fi
+echo "All smoke checks passed."